@@ -0,0 +1,298 @@
+//======================================================================================================
+// ADC sample stream to a UART link on chained uDMA transfers
+//======================================================================================================
+
+#include "inc/tm4c1294ncpdt.h"
+#include "adc.h"
+#include "clock.h"
+#include "hw.h"
+#include "log.h"
+#include "trace.h"
+#include "udma.h"
+#include "vector.h"
+
+//========================================================================================================
+// Result FIFO of sample sequencer 3, the source of the uDMA channel
+//========================================================================================================
+
+#define ADC0_SSFIFO3 0x400380A8
+
+#define ADC_ACTSS_ASEN3 (1u<<3)     // sample sequencer 3 enabled
+#define ADC_ACTSS_ADEN3 (1u<<11)    // uDMA requests of sample sequencer 3
+#define ADC_INT_DMASS3 (1u<<11)     // uDMA channel of sample sequencer 3 completed (DMAINR3)
+#define ADC_OSTAT_OV3 (1u<<3)       // FIFO of sample sequencer 3 overflowed
+
+//========================================================================================================
+// Register offsets in the timer blocks and in port E (AIN0..3 on PE3..PE0), next to those of hw.h
+//========================================================================================================
+
+#define GPTM_ADCEV 0x070
+
+#define GPIO_PORTE_BASE 0x4005C000  // AHB aperture
+#define GPIO_PORTE 4                // bit in RCGCGPIO/PRGPIO
+#define GPIO_AMSEL 0x528
+
+//========================================================================================================
+// Control word of a block: 16 bit results from the fixed FIFO address into consecutive halfwords,
+// one result per request
+//========================================================================================================
+
+#define ADC_CONTROL UDMA_CONTROL(UDMA_INC_16, UDMA_INC_NONE, UDMA_SIZE_16, UDMA_ARB_1, \
+                                 ADC_BLOCK_SAMPLES, UDMA_MODE_PINGPONG)
+
+static AdcStream *adcActive;
+
+//========================================================================================================
+// Arm the primary (half = 0) or alternate (half = 1) structure with a fresh pool block, the samples
+// behind the header. If the pool is empty the structure stays in stop mode and the uDMA halts when
+// it gets there.
+// Returns 0 on success, -1 if the pool is empty.
+//========================================================================================================
+
+static int adcArm(AdcStream *s, unsigned int half) {
+    UdmaControl *c = &controlTable[half*UDMA_ALT + s->channel];
+    PoolBuf *buf = poolAlloc();
+
+    if (buf == 0) {
+        c->control = UDMA_MODE_STOP;
+        s->stats.noBuffer++;
+        return -1;
+    }
+    s->buf[half] = buf;
+    c->srcEnd = ADC0_SSFIFO3;
+    c->dstEnd = (unsigned int)&buf->data[ADC_BLOCK_LEN - 2];
+    c->control = ADC_CONTROL;
+    return 0;
+}
+
+//========================================================================================================
+// Arm the structures that have no block and enable the channel again (see uartRxRefill())
+//========================================================================================================
+
+static void adcRefill(AdcStream *s) {
+    unsigned int bit = 1u<<s->channel;
+    unsigned int half;
+
+    for (half = 0; half < 2; half++) {
+        if (s->buf[half] == 0) {
+            adcArm(s, half);
+        }
+    }
+    if (s->buf[(UDMA_ALTSET_R & bit) ? 1 : 0]) {
+        UDMA_ENASET_R = bit;
+    }
+}
+
+//========================================================================================================
+// Stream AIN<input> at hz samples per second, triggered by timer A of GPTM<timer> (1..7, GPTM 0
+// runs the event loop; a timer that paces a link cannot trigger as well). udmaInit() and poolInit()
+// must have been called. ready is posted with every completed block.
+// The channel and the first two blocks are allocated first, nothing is touched if one of them is
+// missing.
+// RCGCGPIO/PRGPIO, SCGCGPIO:
+// clock for port E
+// GPIOAFSEL/GPIODEN/GPIOAMSEL:
+// the pin of the input is analog: alternate function, digital off, analog isolation off
+// RCGCADC/PRADC, SCGCADC:
+// clock for ADC0, kept while the CPU sleeps with auto clock gating (see idle.h)
+// ADCCC:
+// CS = 0, CLKDIV = 14 => conversion clock of 32 MHz from the 480 MHz PLL VCO
+// ADCPC:
+// SR = 0x7 => full rate (2 Msamples/s)
+// ADCACTSS:
+// ASEN3 = 0 while the sequencer is set up, then ASEN3 and ADEN3 (uDMA requests)
+// ADCEMUX:
+// EM3 = 0x5 => sequencer 3 is started by the timer
+// ADCSSMUX3:
+// the input of the single step
+// ADCSSCTL3:
+// END0 = 1 => one step, IE0 = 1 => each result raises the request of the uDMA channel
+// ADCISC/ADCIM:
+// DMAMASK3 = 1 => interrupt when the channel has completed a block, installed in the vector table
+// (see vector.h). The results themselves do not interrupt.
+// Trigger timer, RCGCTIMER/PRTIMER, SCGCTIMER:
+// clock for the timer, kept while the CPU sleeps
+// GPTMCFG/GPTMTAMR/GPTMTAILR:
+// 32 bit periodic count down, clockGet() / hz cycles per period
+// GPTMADCEV:
+// TATOADCEN = 1 => the timeout triggers the ADC
+// GPTMCTL:
+// TAOTE = 1 => timeout drives the ADC trigger, TAEN = 1 => run
+// Returns 0 on success, -1 on a bad input, timer or rate, a stream that runs already, a timer that
+// is taken (udmaTimerAlloc()), no free channel or an empty pool.
+//========================================================================================================
+
+int adcStreamStart(AdcStream *s, unsigned int input, unsigned int timer, unsigned int hz,
+                   Event *ready) {
+    unsigned int base = GPTM_BASE + timer*0x1000;
+    unsigned int pin = 1u<<(3 - input);
+    unsigned int period;
+    int ch;
+
+    if (adcActive || input >= ADC_INPUTS || timer == 0 || timer >= GPTM_TIMERS || hz == 0) {
+        return -1;
+    }
+    period = clockGet() / hz;
+    if (period < 2) {
+        return -1;
+    }
+    if (udmaTimerAlloc(timer) != 0) {
+        return -1;
+    }
+    ch = udmaChannelAlloc(UDMA_ADC0(3), UDMA_PRIO_HIGH);
+    if (ch < 0) {
+        udmaTimerFree(timer);
+        return -1;
+    }
+    s->input = input;
+    s->timer = timer;
+    s->channel = ch;
+    s->buf[0] = 0;
+    s->buf[1] = 0;
+    s->seq = 0;
+    s->ready = ready;
+    s->stats.blocks = 0;
+    s->stats.sent = 0;
+    s->stats.noBuffer = 0;
+    s->stats.overflows = 0;
+    poolFifoInit(&s->fifo);
+    if (adcArm(s, 0) != 0 || adcArm(s, 1) != 0) {
+        if (s->buf[0]) {
+            poolRelease(s->buf[0]);
+        }
+        udmaChannelFree(ch);
+        udmaTimerFree(timer);
+        return -1;
+    }
+    adcActive = s;
+
+    SYSCTL_RCGCGPIO_R |= (1u<<GPIO_PORTE);
+    while ((SYSCTL_PRGPIO_R & (1u<<GPIO_PORTE)) == 0);
+    SYSCTL_SCGCGPIO_R |= (1u<<GPIO_PORTE);
+    HWREG(GPIO_PORTE_BASE + GPIO_AFSEL) |= pin;
+    HWREG(GPIO_PORTE_BASE + GPIO_DEN) &= ~pin;
+    HWREG(GPIO_PORTE_BASE + GPIO_AMSEL) |= pin;
+
+    SYSCTL_RCGCADC_R |= 0x01;
+    while ((SYSCTL_PRADC_R & 0x01) == 0);
+    SYSCTL_SCGCADC_R |= 0x01;
+    ADC0_CC_R = (14u<<4);
+    ADC0_PC_R = 0x7;
+    ADC0_ACTSS_R &= ~(ADC_ACTSS_ASEN3 | ADC_ACTSS_ADEN3);
+    ADC0_EMUX_R = (ADC0_EMUX_R & ~0xF000u) | (0x5u<<12);
+    ADC0_SSMUX3_R = input;
+    ADC0_SSCTL3_R = 0x6;
+    ADC0_OSTAT_R = ADC_OSTAT_OV3;
+    ADC0_ISC_R = ADC_INT_DMASS3;
+    ADC0_IM_R |= ADC_INT_DMASS3;
+    traceSubmit(ch);
+    UDMA_ENASET_R = (1u<<ch);
+    vectorRegister(VECTOR_IRQ(INT_ADC0SS3), Adc0Seq3Handler);
+    HWREG(NVIC_EN + 4*(INT_ADC0SS3/32)) = (1u<<(INT_ADC0SS3%32));
+    ADC0_ACTSS_R |= ADC_ACTSS_ASEN3 | ADC_ACTSS_ADEN3;
+
+    SYSCTL_RCGCTIMER_R |= (1u<<timer);
+    while ((SYSCTL_PRTIMER_R & (1u<<timer)) == 0);
+    SYSCTL_SCGCTIMER_R |= (1u<<timer);
+    HWREG(base + GPTM_CTL) = 0;
+    HWREG(base + GPTM_CFG) = 0x0;
+    HWREG(base + GPTM_TAMR) = 0x2;
+    HWREG(base + GPTM_TAILR) = period - 1;
+    HWREG(base + GPTM_ADCEV) = 0x1;
+    HWREG(base + GPTM_CTL) = 0x21;
+    return 0;
+}
+
+//========================================================================================================
+// Send the completed blocks on the TX queue of uart straight from the pool, up to TX_TASKS in one
+// message, unless a message is still being sent. The TX queue holds its own references until the
+// message has been sent, the ones from the FIFO are dropped right away; if the stream ran short of
+// blocks, adcStreamKick() lets it take them. Main loop only.
+// Returns the number of blocks handed over.
+//========================================================================================================
+
+unsigned int adcStreamSend(AdcStream *s, Uart *uart) {
+    PoolSlice slice;
+    unsigned int n = 0;
+
+    if (poolFifoEmpty(&s->fifo) || txQueueBusy(&uart->tx)) {
+        return 0;
+    }
+    txQueueReset(&uart->tx);
+    while (n < TX_TASKS && poolFifoGet(&s->fifo, &slice) == 0) {
+        txQueueAddBuf(&uart->tx, slice.buf, slice.data, slice.len);
+        poolRelease(slice.buf);
+        n++;
+    }
+    txQueueSubmit(&uart->tx);
+    s->stats.sent += n;
+    adcStreamKick(s);
+    return n;
+}
+
+//========================================================================================================
+// Blocks have been returned to the pool: if the stream is short of a block, pend its interrupt,
+// whose handler re-arms the structures. May be called from any context.
+//========================================================================================================
+
+void adcStreamKick(AdcStream *s) {
+    if (s != adcActive || (s->buf[0] && s->buf[1])) {
+        return;
+    }
+    HWREG(NVIC_PEND + 4*(INT_ADC0SS3/32)) = (1u<<(INT_ADC0SS3%32));
+}
+
+//========================================================================================================
+// A block is complete: write its header and pass it on with the reference of the uDMA. The uDMA
+// has moved on to the other block, which is traced as the next transfer (see trace.h).
+//========================================================================================================
+
+static void adcBlockDone(AdcStream *s, unsigned int half, unsigned int entry) {
+    PoolBuf *buf = s->buf[half];
+
+    traceComplete(s->channel, entry);
+    traceSubmit(s->channel);
+    buf->data[0] = ADC_MAGIC0;
+    buf->data[1] = ADC_MAGIC1;
+    buf->data[2] = (unsigned char)s->seq;
+    buf->data[3] = (unsigned char)(s->seq >> 8);
+    s->seq++;
+    s->stats.blocks++;
+    s->buf[half] = 0;
+    poolFifoPut(&s->fifo, buf, buf->data, ADC_BLOCK_LEN);
+    if (s->ready) {
+        eventPost(s->ready);
+    }
+}
+
+//========================================================================================================
+// Interrupt handler of sample sequencer 3 (installed by adcStreamStart()): DMAINR3 is raised when
+// the channel has completed a block. Both structures are checked, as in uartIsr(), then results
+// lost in the FIFO of the sequencer are counted and the structures re-armed. Also runs when
+// adcStreamKick() pends it.
+// Entry and exit are stamped for the latency figures of the channel (see trace.h).
+//========================================================================================================
+
+void Adc0Seq3Handler(void) {
+    unsigned int entry = traceCycles();
+    AdcStream *s = adcActive;
+    unsigned int half;
+
+    ADC0_ISC_R = ADC_INT_DMASS3;
+    if (s == 0) {
+        return;
+    }
+    for (half = 0; half < 2; half++) {
+        if (s->buf[half] &&
+            UDMA_CONTROL_MODE(controlTable[half*UDMA_ALT + s->channel].control) == UDMA_MODE_STOP) {
+            adcBlockDone(s, half, entry);
+        }
+    }
+    if (ADC0_OSTAT_R & ADC_OSTAT_OV3) {
+        ADC0_OSTAT_R = ADC_OSTAT_OV3;
+        s->stats.overflows++;
+        logWrite(LOG_ADC_OVERFLOW, 3, s->stats.overflows);
+    }
+    adcRefill(s);
+    traceIsr(s->channel, entry);
+}
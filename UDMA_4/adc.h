@@ -0,0 +1,74 @@
+//======================================================================================================
+// ADC sample stream to a UART link on chained uDMA transfers
+//======================================================================================================
+// Sample sequencer 3 of ADC0 converts one analog input (AIN0..3 on PE3..PE0) at every timeout of
+// a general purpose timer, so the sample rate is set by the timer and not by software. Each result
+// is a single request of the uDMA channel of the sequencer, which runs in ping-pong mode over two
+// blocks of the buffer pool (see pool.h), as the receive path of a UART link does: while the uDMA
+// fills one block the other one is handed on, and a fresh block takes its place.
+//
+// A block is a frame as it goes out on the line: ADC_HEADER_LEN bytes of header followed by
+// ADC_BLOCK_SAMPLES samples of 16 bits (12 bit results, least significant byte first). The header
+// is ADC_MAGIC0, ADC_MAGIC1 and a 16 bit sequence number (least significant byte first) that
+// counts every block completed, so the receiver sees the blocks that were dropped. The uDMA writes
+// the samples behind the header; the interrupt handler only writes the header and passes the block
+// by reference through a PoolFifo. adcStreamSend() then hands the blocks to the TX queue of a link
+// with txQueueAddBuf(), up to TX_TASKS of them in one scatter-gather message. No sample is copied
+// and the CPU touches the stream once per block on each side.
+//
+// Losses are counted, not hidden: a completed block that finds the PoolFifo full is dropped
+// (fifo.dropped), a block that cannot be replaced leaves its structure in stop mode (noBuffer)
+// and the uDMA halts there, and results that found the one deep FIFO of the sequencer full are
+// lost (overflows, OSTAT). Once blocks are back, adcStreamKick() lets the stream re-arm, as
+// uartRxKick() does for a link.
+//
+// The link has to keep up with the stream: hz * ADC_BLOCK_LEN / ADC_BLOCK_SAMPLES bytes/s, against
+// a line rate of baud / 10 bytes/s.
+//
+// One stream at a time: adcStreamStart() installs Adc0Seq3Handler in the vector table in SRAM
+// (see vector.h).
+//
+// Usage:
+// adcStreamStart(&stream, 0, 1, 8000, &readyEvent);
+// handler of readyEvent (and of the TX done event of the link): adcStreamSend(&stream, &link);
+//======================================================================================================
+
+#ifndef ADC_H
+#define ADC_H
+
+#include "event.h"
+#include "pool.h"
+#include "uart.h"
+
+#define ADC_INPUTS 4                // AIN0..3
+#define ADC_HEADER_LEN 4
+#define ADC_MAGIC0 0xA5
+#define ADC_MAGIC1 0x5A
+#define ADC_BLOCK_SAMPLES ((POOL_BLOCK_SIZE - ADC_HEADER_LEN) / 2)
+#define ADC_BLOCK_LEN (ADC_HEADER_LEN + 2*ADC_BLOCK_SAMPLES)   // bytes of a block on the line
+
+typedef struct {
+    unsigned int blocks;        // blocks completed by the uDMA
+    unsigned int sent;          // blocks handed to the TX queue of the link
+    unsigned int noBuffer;      // pool empty when a block had to be replaced
+    unsigned int overflows;     // interrupts that found results lost in the sequencer FIFO
+} AdcStats;
+
+typedef struct {
+    unsigned int input;         // AIN number
+    unsigned int timer;         // GPTM that triggers the conversions
+    unsigned int channel;       // uDMA channel of sample sequencer 3
+    PoolBuf *buf[2];            // block of the primary and alternate structure, 0 if none
+    unsigned int seq;           // sequence number of the next completed block
+    PoolFifo fifo;              // completed blocks, interrupt handler to adcStreamSend()
+    Event *ready;               // posted with every completed block, 0 for none
+    AdcStats stats;
+} AdcStream;
+
+int adcStreamStart(AdcStream *s, unsigned int input, unsigned int timer, unsigned int hz,
+                   Event *ready);
+unsigned int adcStreamSend(AdcStream *s, Uart *uart);
+void adcStreamKick(AdcStream *s);
+void Adc0Seq3Handler(void);
+
+#endif // ADC_H
@@ -0,0 +1,22 @@
+//======================================================================================================
+// Compare and swap of a word
+//======================================================================================================
+
+#include "atomic.h"
+
+//========================================================================================================
+// LDREX/STREX on the target, GCC atomics on the host build. Returns 1 if value was written.
+//========================================================================================================
+
+int atomicSwap(volatile unsigned int *word, unsigned int expect, unsigned int value) {
+#if defined(__TI_ARM__)
+    if (__ldrex((void *)word) != expect) {
+        __clrex();
+        return 0;
+    }
+    return __strex(value, (void *)word) == 0;
+#else
+    return __atomic_compare_exchange_n(word, &expect, value, 0, __ATOMIC_ACQ_REL,
+                                       __ATOMIC_RELAXED);
+#endif
+}
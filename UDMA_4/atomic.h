@@ -0,0 +1,24 @@
+//======================================================================================================
+// Compare and swap of a word
+//======================================================================================================
+// atomicSwap() writes value to *word if it still holds expect and tells whether it did. It is the
+// one primitive of the lock-free structures (pool free map and reference counts, log ring, event
+// queues), safe between the main loop and nested interrupt handlers.
+//
+// On the target it is an exclusive load/store pair (LDREX/STREX): the store fails if anything
+// wrote the word, or an exception was taken, since the load. When the word does not hold expect,
+// the exclusive monitor is cleared (CLREX) before returning, so no reservation is left open for
+// a later STREX. The host build uses the GCC atomics.
+//
+// Usage:
+// do {
+//     head = q->head;
+// } while (!atomicSwap(&q->head, head, head + 1));
+//======================================================================================================
+
+#ifndef ATOMIC_H
+#define ATOMIC_H
+
+int atomicSwap(volatile unsigned int *word, unsigned int expect, unsigned int value);
+
+#endif // ATOMIC_H
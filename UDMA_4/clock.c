@@ -0,0 +1,94 @@
+//======================================================================================================
+// System clock and UART baud rate divisors
+//======================================================================================================
+
+#include "inc/tm4c1294ncpdt.h"
+#include "clock.h"
+
+//========================================================================================================
+// PLL setting for 480 MHz from the 25 MHz crystal
+// fVCO = fXTAL / ((Q+1) * (N+1)) * MINT = 25 MHz / 5 * 96
+// System clock = fVCO / (PSYSDIV+1) = 480 MHz / 4
+//========================================================================================================
+
+#define PLL_Q 0
+#define PLL_N 4
+#define PLL_MINT 96
+#define PLL_PSYSDIV (CLOCK_VCO_HZ/CLOCK_SYSCLK_HZ - 1)
+
+//========================================================================================================
+// Flash and EEPROM timing for 100 MHz < SysClk <= 120 MHz (datasheet table "MEMTIM0 Register
+// Configuration versus Frequency"): 5 wait states, bank clock high time 3.5 system clocks
+//========================================================================================================
+
+#define MEM_WS 5
+#define MEM_BCHT 6
+
+static unsigned int clockHz = CLOCK_PIOSC_HZ;
+
+//========================================================================================================
+// Switch the system clock to the PLL at 120 MHz:
+// MOSCCTL:
+// OSCRNG = 1 => crystal above 10 MHz, clear PWRDN and NOXTAL to start the main oscillator,
+// then wait for MOSCPUPRIS in RIS.
+// RSCLKCFG:
+// PLLSRC = MOSC (3). OSCSRC stays at PIOSC, so the clock does not change before the PLL is used.
+// PLLFREQ1/PLLFREQ0:
+// N, Q and MINT of the 480 MHz VCO, PLLPWR powers the PLL
+// MEMTIM0:
+// Wait states and bank clock high time for the new frequency. They take effect together with the
+// clock when MEMTIMU is written to RSCLKCFG, so the flash is never too fast for the clock.
+// RSCLKCFG:
+// NEWFREQ makes the PLL take the new setting, then wait for LOCK in PLLSTAT.
+// USEPLL, PSYSDIV = 3 and MEMTIMU switch to 120 MHz.
+//========================================================================================================
+
+void clockInit(void) {
+    SYSCTL_MOSCCTL_R = (SYSCTL_MOSCCTL_R & ~0x0C) | 0x10;
+    while ((SYSCTL_RIS_R & (1<<8)) == 0);
+
+    SYSCTL_RSCLKCFG_R = (0x3<<24);
+
+    SYSCTL_PLLFREQ1_R = (PLL_Q<<8) | PLL_N;
+    SYSCTL_PLLFREQ0_R = (1<<23) | PLL_MINT;
+
+    SYSCTL_MEMTIM0_R = (SYSCTL_MEMTIM0_R & ~0x03EF03EF) |
+                       (MEM_BCHT<<22) | (MEM_WS<<16) | (MEM_BCHT<<6) | MEM_WS;
+
+    SYSCTL_RSCLKCFG_R |= (1u<<30);
+    while ((SYSCTL_PLLSTAT_R & 0x01) == 0);
+
+    SYSCTL_RSCLKCFG_R = (1u<<31) | (1<<28) | (0x3<<24) | PLL_PSYSDIV;
+    clockHz = CLOCK_SYSCLK_HZ;
+}
+
+//========================================================================================================
+// Current system clock in Hz
+//========================================================================================================
+
+unsigned int clockGet(void) {
+    return clockHz;
+}
+
+//========================================================================================================
+// Baud rate divisor for the current system clock. The divisor is computed in 1/64 units and rounded:
+// 64 * SysClk / (16 * baud) = 4 * SysClk / baud, or 8 * SysClk / baud with HSE. Both fit in 32 bits
+// for SysClk <= 120 MHz (twice the value plus one for the rounding: 1.92e9).
+// Returns 0 on success, -1 if the rate cannot be reached (above SysClk / 8, or IBRD above 65535).
+//========================================================================================================
+
+int clockUartDivisor(unsigned int baud, UartDivisor *div) {
+    unsigned int brd;
+
+    if (baud == 0 || baud > clockHz / 8) {
+        return -1;
+    }
+    div->hse = baud > clockHz / 16;
+    brd = ((clockHz * (div->hse ? 16u : 8u)) / baud + 1) / 2;
+    div->ibrd = brd >> 6;
+    div->fbrd = brd & 0x3F;
+    if (div->ibrd == 0 || div->ibrd > 0xFFFF || (div->ibrd == 0xFFFF && div->fbrd != 0)) {
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,40 @@
+//======================================================================================================
+// System clock and UART baud rate divisors
+//======================================================================================================
+// clockInit() moves the system clock from the 16 MHz PIOSC (reset clock) to 120 MHz: the 25 MHz
+// crystal of the TM4C1294XL board (MOSC) drives the PLL at a VCO frequency of 480 MHz, which is
+// divided by 4. The flash and EEPROM timing in MEMTIM0 is switched together with the clock.
+//
+// clockUartDivisor() computes the baud rate divisor for any rate from the current system clock:
+//     BRD = SysClk / (ClkDiv * baud), IBRD = integer part, FBRD = round(fraction * 64)
+// ClkDiv is 16, or 8 with HSE set in UARTCTL when the rate is above SysClk / 16. At 120 MHz this
+// reaches 7.5 Mbaud without and 15 Mbaud with HSE.
+//======================================================================================================
+
+#ifndef CLOCK_H
+#define CLOCK_H
+
+//========================================================================================================
+// Frequencies
+//========================================================================================================
+
+#define CLOCK_PIOSC_HZ 16000000     // reset clock
+#define CLOCK_XTAL_HZ 25000000      // MOSC crystal of the TM4C1294XL board
+#define CLOCK_VCO_HZ 480000000      // PLL output, see clockInit()
+#define CLOCK_SYSCLK_HZ 120000000   // system clock after clockInit()
+
+//========================================================================================================
+// UART baud rate divisor
+//========================================================================================================
+
+typedef struct {
+    unsigned int ibrd;      // UARTIBRD
+    unsigned int fbrd;      // UARTFBRD
+    unsigned int hse;       // 1: set HSE in UARTCTL (8x oversampling)
+} UartDivisor;
+
+void clockInit(void);
+unsigned int clockGet(void);
+int clockUartDivisor(unsigned int baud, UartDivisor *div);
+
+#endif // CLOCK_H
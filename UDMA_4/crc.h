@@ -0,0 +1,26 @@
+//======================================================================================================
+// CRC-32 of frames on the CRC engine of the CCM module
+//======================================================================================================
+// crc32() is the CRC-32 of IEEE 802.3 / zlib (polynomial 0x04C11DB7, reflected, initial value and
+// final XOR 0xFFFFFFFF; crc32("123456789") = 0xCBF43926), as it protects the frames on UART2.
+//
+// The CRC engine of the CCM module (CCM0) computes it while the data is written into CRCDIN, a
+// word per bus cycle. The bytes up to the first word boundary and after the last one are written
+// in 8 bit mode, the words in between in 32 bit mode, all of them by the CPU: at a word per bus
+// cycle a calculation is over before a uDMA transfer could be set up and waited for.
+// The engine holds the state of one calculation: crc32() must only be called from one context
+// (the main loop).
+//
+// crc32Soft() is a table-driven fallback in software (one table lookup per byte) and gives the
+// same result. Builds for a device without the CCM module, or a host build without the register
+// model of the simulator, define CRC_SOFTWARE and crc32() uses it.
+//======================================================================================================
+
+#ifndef CRC_H
+#define CRC_H
+
+int crcInit(void);
+unsigned int crc32(const unsigned char *data, unsigned int len);
+unsigned int crc32Soft(const unsigned char *data, unsigned int len);
+
+#endif // CRC_H
@@ -0,0 +1,263 @@
+//======================================================================================================
+// Memory to memory copies on the software channel of the uDMA
+//======================================================================================================
+
+#include "inc/tm4c1294ncpdt.h"
+#include <stdint.h>
+#include <string.h>
+#include "dmaCopy.h"
+#include "hw.h"
+#include "idle.h"
+#include "trace.h"
+#include "udma.h"
+#include "vector.h"
+
+DmaCopyStats dmaCopyStats;
+
+//========================================================================================================
+// Channel, queue of jobs (written by the submitting context at head, read by the interrupt handler
+// at tail) and the job the channel is working on
+//========================================================================================================
+
+static int dmaChannel = -1;
+static DmaJob *volatile dmaJobs[DMA_COPY_JOBS];
+static volatile unsigned int dmaHead;
+static volatile unsigned int dmaTail;
+static DmaJob *dmaCurrent;
+
+//========================================================================================================
+// Start the copy service (udmaInit() must have been called):
+// The software channel is allocated with the default priority, so the peripheral channels are
+// served first. Its completion raises the uDMA software interrupt, whose handler is installed (see
+// vector.h) and enabled in the NVIC.
+// Returns 0, or -1 if the software channel is taken; every job is then done by the CPU.
+//========================================================================================================
+
+int dmaCopyInit(void) {
+    dmaHead = 0;
+    dmaTail = 0;
+    dmaCurrent = 0;
+    dmaChannel = udmaChannelAlloc(UDMA_SOFTWARE, 0);
+    if (dmaChannel < 0) {
+        return -1;
+    }
+    vectorRegister(VECTOR_IRQ(INT_UDMA), UdmaSoftwareHandler);
+    HWREG(NVIC_EN + 4*(INT_UDMA/32)) = (1u<<(INT_UDMA%32));
+    return 0;
+}
+
+int dmaCopyChannel(void) {
+    return dmaChannel;
+}
+
+//========================================================================================================
+// Item size for addresses and length: log2 of the bytes per item (UDMA_SIZE_8/16/32)
+//========================================================================================================
+
+static unsigned int dmaItemSize(unsigned int bits) {
+    if ((bits & 3) == 0) {
+        return UDMA_SIZE_32;
+    }
+    return (bits & 1) == 0 ? UDMA_SIZE_16 : UDMA_SIZE_8;
+}
+
+//========================================================================================================
+// Done: flag and handler
+//========================================================================================================
+
+static void dmaJobFinish(DmaJob *job) {
+    job->done = 1;
+    if (job->handler) {
+        job->handler(job);
+    }
+}
+
+//========================================================================================================
+// Queue the job for the channel and pend the uDMA software interrupt, whose handler starts it when
+// the channel is free. Returns -1 if the queue is full or there is no channel.
+//========================================================================================================
+
+static int dmaQueue(DmaJob *job) {
+    unsigned int head = dmaHead;
+
+    if (dmaChannel < 0 || head - dmaTail >= DMA_COPY_JOBS) {
+        return -1;
+    }
+    dmaJobs[head & (DMA_COPY_JOBS-1)] = job;
+    dmaHead = head + 1;
+    HWREG(NVIC_PEND + 4*(INT_UDMA/32)) = (1u<<(INT_UDMA%32));
+    return 0;
+}
+
+//========================================================================================================
+// Next transfer of the current job, at most 1024 items. The end pointers point to the last item;
+// a fixed address is its own end. SWREQ starts the auto transfer, which runs to the end on its own.
+//========================================================================================================
+
+static void dmaStart(DmaJob *job) {
+    unsigned int ch = dmaChannel;
+    unsigned int n = job->items > 1024 ? 1024 : job->items;
+
+    controlTable[ch].srcEnd = job->src + (n - 1)*job->srcStep;
+    controlTable[ch].dstEnd = job->dst + (n - 1)*job->dstStep;
+    controlTable[ch].control = job->control | UDMA_XFERSIZE(n);
+    job->src += n*job->srcStep;
+    job->dst += n*job->dstStep;
+    job->items -= n;
+    dmaCopyStats.transfers++;
+    dmaCopyStats.dmaBytes += n*(job->srcStep > job->dstStep ? job->srcStep : job->dstStep);
+    UDMA_ENASET_R = (1u<<ch);
+    UDMA_SWREQ_R = (1u<<ch);
+}
+
+//========================================================================================================
+// Set up the job fields and queue it. The control word is put together as UDMA_CONTROL_BASE()
+// does, the sizes are only known at run time. Returns 0 if it is queued, -1 if not.
+//========================================================================================================
+
+static int dmaSubmit(DmaJob *job, unsigned int dst, unsigned int dstInc, unsigned int src,
+                     unsigned int srcInc, unsigned int size, unsigned int items,
+                     DmaJobHandler handler, void *context) {
+    job->dst = dst;
+    job->src = src;
+    job->dstStep = dstInc == UDMA_INC_NONE ? 0 : 1u<<size;
+    job->srcStep = srcInc == UDMA_INC_NONE ? 0 : 1u<<size;
+    job->items = items;
+    job->control = ((unsigned int)dstInc<<30) | (size<<28) | ((unsigned int)srcInc<<26)
+                 | (size<<24) | ((unsigned int)UDMA_ARB_32<<14) | UDMA_MODE_AUTO;
+    job->done = 0;
+    job->handler = handler;
+    job->context = context;
+    return dmaQueue(job);
+}
+
+//========================================================================================================
+// Copy len bytes from src to dst. The buffers must not overlap.
+// Returns 0 if the uDMA does the copy, 1 if the CPU has done it already.
+//========================================================================================================
+
+int dmaMemcpy(DmaJob *job, void *dst, const void *src, unsigned int len, DmaJobHandler handler,
+              void *context) {
+    unsigned int size = dmaItemSize((unsigned int)dst | (unsigned int)src | len);
+
+    if (len >= DMA_COPY_MIN &&
+        dmaSubmit(job, (unsigned int)dst, size, (unsigned int)src, size, size, len >> size,
+                  handler, context) == 0) {
+        return 0;
+    }
+    memcpy(dst, src, len);
+    job->done = 0;
+    job->handler = handler;
+    job->context = context;
+    dmaCopyStats.cpuJobs++;
+    dmaJobFinish(job);
+    return 1;
+}
+
+//========================================================================================================
+// Fill len bytes at dst with value. The uDMA reads the value, replicated to a word, from job->fill
+// over and over.
+// Returns 0 if the uDMA does the fill, 1 if the CPU has done it already.
+//========================================================================================================
+
+int dmaMemset(DmaJob *job, void *dst, unsigned char value, unsigned int len,
+              DmaJobHandler handler, void *context) {
+    unsigned int size = dmaItemSize((unsigned int)dst | len);
+
+    job->fill = value * 0x01010101u;
+    if (len >= DMA_COPY_MIN &&
+        dmaSubmit(job, (unsigned int)dst, size, (unsigned int)&job->fill, UDMA_INC_NONE, size,
+                  len >> size, handler, context) == 0) {
+        return 0;
+    }
+    memset(dst, value, len);
+    job->done = 0;
+    job->handler = handler;
+    job->context = context;
+    dmaCopyStats.cpuJobs++;
+    dmaJobFinish(job);
+    return 1;
+}
+
+//========================================================================================================
+// Write words from src (word aligned) one after the other into the register at address reg.
+// Returns 0 if the uDMA does the writes, 1 if the CPU has done them already.
+//========================================================================================================
+
+int dmaWriteRegister(DmaJob *job, unsigned int reg, const void *src, unsigned int words,
+                     DmaJobHandler handler, void *context) {
+    const uint32_t *w = src;
+    unsigned int n;
+
+    if (4*words >= DMA_COPY_MIN &&
+        dmaSubmit(job, reg, UDMA_INC_NONE, (unsigned int)src, UDMA_INC_32, UDMA_SIZE_32, words,
+                  handler, context) == 0) {
+        return 0;
+    }
+    for (n = 0; n < words; n++) {
+        HWREG(reg) = w[n];
+    }
+    job->done = 0;
+    job->handler = handler;
+    job->context = context;
+    dmaCopyStats.cpuJobs++;
+    dmaJobFinish(job);
+    return 1;
+}
+
+//========================================================================================================
+// Wait until the job is done, asleep in WFI (idleSleep()) between the interrupts. Interrupts are
+// masked around the test and the sleep as in eventWait(), so a completion between the two still
+// ends the sleep. Must not be called from an interrupt handler of the same or a higher priority
+// than the uDMA software interrupt.
+//========================================================================================================
+
+void dmaJobWait(DmaJob *job) {
+    while (!job->done) {
+        __disable_irq();
+        if (!job->done) {
+            idleSleep();
+        }
+        __enable_irq();
+    }
+}
+
+//========================================================================================================
+// uDMA software interrupt: raised when the software channel has finished a transfer and pended by
+// dmaQueue(). CHIS bit of the channel is cleared first. A job that has items left is continued,
+// a finished one is completed and the next queued job started.
+//========================================================================================================
+
+void UdmaSoftwareHandler(void) {
+    unsigned int entry = traceCycles();
+    unsigned int ch = dmaChannel;
+    DmaJob *job;
+
+    if (dmaChannel < 0) {
+        return;
+    }
+    UDMA_CHIS_R = (1u<<ch);
+    if (dmaCurrent && (UDMA_ENASET_R & (1u<<ch))) {
+        return;                     // pended by dmaQueue() while a transfer is running
+    }
+    job = dmaCurrent;
+    if (job && job->items) {
+        dmaStart(job);
+        traceIsr(ch, entry);
+        return;
+    }
+    if (job) {
+        dmaCurrent = 0;
+        traceComplete(ch, entry);
+        dmaCopyStats.dmaJobs++;
+        dmaJobFinish(job);
+    }
+    if (dmaTail != dmaHead) {
+        job = dmaJobs[dmaTail & (DMA_COPY_JOBS-1)];
+        dmaTail++;
+        dmaCurrent = job;
+        traceSubmit(ch);
+        dmaStart(job);
+    }
+    traceIsr(ch, entry);
+}
@@ -0,0 +1,75 @@
+//======================================================================================================
+// Memory to memory copies on the software channel of the uDMA
+//======================================================================================================
+// dmaMemcpy() and dmaMemset() move a buffer with the uDMA instead of the CPU: the software channel
+// runs in auto mode, so once started by SWREQ it moves the whole transfer (up to 1024 items) on its
+// own, and the CPU is free or asleep meanwhile. dmaWriteRegister() feeds words into one register,
+// e.g. the data register of a peripheral.
+//
+// The item size is the widest one that dst, src and len are aligned to: words when all three are
+// multiples of 4, then halfwords, then bytes. Longer buffers are moved in several transfers of at
+// most 1024 items, chained by the interrupt handler. ARBSIZE = 32: the channel gives the bus up
+// after 32 items, so the UART channels are served in between.
+//
+// Every operation is described by a DmaJob of the caller, which has to stay in place until the job
+// is done. Jobs are queued (DMA_COPY_JOBS at most) and run one after the other. When a job is done
+// job->done is set and its handler, if any, is called from the uDMA software interrupt.
+// A job shorter than DMA_COPY_MIN bytes, which the CPU moves faster than it could set up the
+// channel and take the interrupt, is done by the CPU right away, as is any job when the queue is
+// full or there is no channel; the handler is then called before the function returns.
+//
+// Jobs must be submitted from one context (the main loop): the queue has a single producer, the
+// interrupt handler is the single consumer and alone starts the channel. Handlers called from the
+// interrupt must therefore not submit jobs themselves.
+//
+// Usage:
+// dmaMemcpy(&job, frame, block, 512, copied, 0);   // copied(&job) is called when it is done
+// dmaMemset(&job2, table, 0, sizeof(table), 0, 0);
+// dmaJobWait(&job2);
+//======================================================================================================
+
+#ifndef DMACOPY_H
+#define DMACOPY_H
+
+#define DMA_COPY_MIN 128        // bytes from which the uDMA does the copy
+#define DMA_COPY_JOBS 8         // queued jobs, must be a power of two
+
+typedef struct DmaJob DmaJob;
+
+typedef void (*DmaJobHandler)(DmaJob *job);
+
+struct DmaJob {
+    unsigned int dst;           // next destination item (address as a word, like UdmaControl)
+    unsigned int src;           // next source item
+    unsigned int dstStep;       // bytes per item, 0 if the address stays
+    unsigned int srcStep;
+    unsigned int items;         // items still to be started
+    unsigned int control;       // control word without XFERSIZE
+    unsigned int fill;          // dmaMemset(): the value in every byte, source of the uDMA
+    volatile int done;
+    DmaJobHandler handler;
+    void *context;              // for the handler
+};
+
+typedef struct {
+    unsigned int dmaJobs;       // jobs done by the uDMA
+    unsigned int cpuJobs;       // jobs done by the CPU (short, queue full or no channel)
+    unsigned int dmaBytes;      // bytes moved by the uDMA
+    unsigned int transfers;     // transfers of up to 1024 items started
+} DmaCopyStats;
+
+extern DmaCopyStats dmaCopyStats;
+
+int dmaCopyInit(void);
+int dmaMemcpy(DmaJob *job, void *dst, const void *src, unsigned int len, DmaJobHandler handler,
+              void *context);
+int dmaMemset(DmaJob *job, void *dst, unsigned char value, unsigned int len,
+              DmaJobHandler handler, void *context);
+int dmaWriteRegister(DmaJob *job, unsigned int reg, const void *src, unsigned int words,
+                     DmaJobHandler handler, void *context);
+void dmaJobWait(DmaJob *job);
+int dmaCopyChannel(void);
+
+void UdmaSoftwareHandler(void);
+
+#endif // DMACOPY_H
@@ -0,0 +1,323 @@
+//======================================================================================================
+// Cooperative event loop with prioritized run-to-completion handlers
+//======================================================================================================
+
+#include "inc/tm4c1294ncpdt.h"
+#include <stdint.h>
+#include "atomic.h"
+#include "clock.h"
+#include "event.h"
+#include "hw.h"
+#include "idle.h"
+#include "trace.h"
+#include "udma.h"
+#include "vector.h"
+
+//========================================================================================================
+// Queue of one priority. A slot is claimed by advancing head and published by writing its sequence
+// number (claimed index + 1) last, as the entries of log.c.
+//========================================================================================================
+
+typedef struct {
+    volatile unsigned int seq;
+    Event *volatile event;
+} EventSlot;
+
+typedef struct {
+    EventSlot slots[EVENT_QUEUE_LEN];
+    volatile unsigned int head;     // next slot to claim (eventPost())
+    volatile unsigned int tail;     // next slot to run (main loop)
+    volatile unsigned int dropped;
+    TraceStats latency;             // main loop only
+    TraceStats run;
+} EventQueue;
+
+static EventQueue eventQueues[EVENT_PRIORITIES];
+
+//========================================================================================================
+// Armed timers, earliest first, and the event the timer interrupt posts
+//========================================================================================================
+
+static EventTimer *eventTimers;
+
+static void eventTimerService(Event *event);
+
+static Event eventTick = EVENT_INIT(eventTimerService, EVENT_PRIO_HIGH, 0);
+
+static void eventClear(TraceStats *s) {
+    unsigned int n;
+
+    s->count = 0;
+    s->min = 0;
+    s->max = 0;
+    s->sum = 0;
+    for (n = 0; n < TRACE_BUCKETS; n++) {
+        s->hist[n] = 0;
+    }
+}
+
+//========================================================================================================
+// Empty queues, no timer armed, start Timer 0 for the timers (idleInit() must have been called).
+// Timer 0 is claimed (udmaTimerAlloc()) so that no other driver can take it.
+// RCGCTIMER/PRTIMER:
+// clock for Timer 0, wait until it is ready
+// SCGCTIMER:
+// Timer 0 keeps its clock while the CPU sleeps with auto clock gating (see idle.h)
+// GPTMCTL:
+// TAEN = 0 => stopped, eventTimerArm() starts it
+// GPTMCFG:
+// 0x0 => 32 bit timer, timer A and B concatenated
+// GPTMTAMR:
+// TAMR = 0x1 => one-shot, TACDIR = 0 => count down, on the system clock
+// GPTMIMR:
+// TATOIM = 1 => interrupt on the timeout of timer A, installed in the vector table (see vector.h)
+//========================================================================================================
+
+void eventInit(void) {
+    unsigned int p, n;
+
+    for (p = 0; p < EVENT_PRIORITIES; p++) {
+        EventQueue *q = &eventQueues[p];
+        q->head = 0;
+        q->tail = 0;
+        q->dropped = 0;
+        for (n = 0; n < EVENT_QUEUE_LEN; n++) {
+            q->slots[n].seq = 0;
+        }
+        eventClear(&q->latency);
+        eventClear(&q->run);
+    }
+    eventTimers = 0;
+    eventTick.pending = 0;
+
+    (void)udmaTimerAlloc(0);
+    SYSCTL_RCGCTIMER_R |= 0x01;
+    while ((SYSCTL_PRTIMER_R & 0x01) == 0);
+    SYSCTL_SCGCTIMER_R |= 0x01;
+    TIMER0_CTL_R = 0;
+    TIMER0_CFG_R = 0x0;
+    TIMER0_TAMR_R = 0x1;
+    TIMER0_ICR_R = 0x1;
+    TIMER0_IMR_R = 0x1;
+    vectorRegister(VECTOR_IRQ(INT_TIMER0A), EventTimerHandler);
+    HWREG(NVIC_EN + 4*(INT_TIMER0A/32)) = (1u<<(INT_TIMER0A%32));
+}
+
+//========================================================================================================
+// Queue an event. Safe to call from interrupt context.
+// Returns 0 if the event was queued, 1 if it was already, -1 if its queue was full (counted in
+// dropped of the priority).
+//========================================================================================================
+
+int eventPost(Event *event) {
+    EventQueue *q = &eventQueues[event->priority % EVENT_PRIORITIES];
+    EventSlot *slot;
+    unsigned int head;
+
+    if (!atomicSwap(&event->pending, 0, 1)) {
+        event->coalesced++;
+        return 1;
+    }
+    event->posted = idleNow();
+    do {
+        head = q->head;
+        if (head - q->tail >= EVENT_QUEUE_LEN) {
+            q->dropped++;
+            event->pending = 0;
+            return -1;
+        }
+    } while (!atomicSwap(&q->head, head, head + 1));
+
+    event->posts++;
+    slot = &q->slots[head & (EVENT_QUEUE_LEN-1)];
+    slot->event = event;
+    slot->seq = head + 1;
+    return 0;
+}
+
+//========================================================================================================
+// Run the handler of the oldest event of the highest priority that has one. Main loop only.
+// Returns 1 if a handler ran, 0 if all queues were empty.
+//========================================================================================================
+
+int eventRunOne(void) {
+    unsigned long long start, latency;
+    unsigned int p;
+    EventQueue *q;
+    EventSlot *slot;
+    Event *event;
+
+    for (p = 0; p < EVENT_PRIORITIES; p++) {
+        q = &eventQueues[p];
+        slot = &q->slots[q->tail & (EVENT_QUEUE_LEN-1)];
+        if (q->tail == q->head || slot->seq != q->tail + 1) {
+            continue;               // empty, or claimed but not yet written
+        }
+        event = slot->event;
+        q->tail = q->tail + 1;
+
+        start = idleNow();
+        latency = start > event->posted ? start - event->posted : 0;
+        event->pending = 0;
+        event->runs++;
+        event->handler(event);
+
+        traceAdd(&q->latency, latency > 0xFFFFFFFF ? 0xFFFFFFFF : (unsigned int)latency);
+        traceAdd(&q->run, (unsigned int)(idleNow() - start));
+        return 1;
+    }
+    return 0;
+}
+
+//========================================================================================================
+// Run handlers until all queues are empty. Main loop only.
+//========================================================================================================
+
+void eventRun(void) {
+    while (eventRunOne());
+}
+
+int eventPending(void) {
+    unsigned int p;
+
+    for (p = 0; p < EVENT_PRIORITIES; p++) {
+        if (eventQueues[p].head != eventQueues[p].tail) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+//========================================================================================================
+// Sleep until the next interrupt unless an event is pending. Main loop only.
+//========================================================================================================
+
+void eventWait(void) {
+    __disable_irq();
+    if (!eventPending()) {
+        idleSleep();
+    }
+    __enable_irq();
+}
+
+//========================================================================================================
+// Let Timer 0 count down to the earliest due time, or stop it when no timer is armed. A due time
+// more than 2^32 cycles ahead (35 s at 120 MHz) is reached in several counts.
+// GPTMCTL:
+// TAEN = 0 => stop, TAILR is loaded when TAEN is set again
+// GPTMTAILR:
+// cycles until the timeout, minus one
+// GPTMICR:
+// TATOCINT = 1 => clear a timeout of the previous count
+//========================================================================================================
+
+static void eventTimerArm(void) {
+    unsigned long long now, wait;
+
+    TIMER0_CTL_R = 0;
+    if (!eventTimers) {
+        return;
+    }
+    now = idleNow();
+    wait = eventTimers->due > now ? eventTimers->due - now : 1;
+    TIMER0_TAILR_R = wait > 0xFFFFFFFF ? 0xFFFFFFFF : (unsigned int)wait - 1;
+    TIMER0_ICR_R = 0x1;
+    TIMER0_CTL_R = 0x1;
+}
+
+static void eventTimerInsert(EventTimer *timer) {
+    EventTimer **at = &eventTimers;
+
+    while (*at && (*at)->due <= timer->due) {
+        at = &(*at)->next;
+    }
+    timer->next = *at;
+    *at = timer;
+    timer->armed = 1;
+}
+
+static void eventTimerUnlink(EventTimer *timer) {
+    EventTimer **at = &eventTimers;
+
+    while (*at && *at != timer) {
+        at = &(*at)->next;
+    }
+    if (*at) {
+        *at = timer->next;
+    }
+    timer->armed = 0;
+}
+
+//========================================================================================================
+// Post timer->event in us microseconds, then every periodUs microseconds (0: once). A timer that
+// is armed already starts over. Main loop only.
+//========================================================================================================
+
+void eventTimerStart(EventTimer *timer, unsigned int us, unsigned int periodUs) {
+    unsigned long long perUs = clockGet() / 1000000;
+
+    if (timer->armed) {
+        eventTimerUnlink(timer);
+    }
+    timer->due = idleNow() + us * perUs;
+    timer->period = periodUs * perUs;
+    eventTimerInsert(timer);
+    if (eventTimers == timer) {
+        eventTimerArm();
+    }
+}
+
+void eventTimerStop(EventTimer *timer) {
+    if (timer->armed) {
+        eventTimerUnlink(timer);
+        eventTimerArm();
+    }
+}
+
+//========================================================================================================
+// Internal event of the timer interrupt: post the event of every expired timer, move periodic
+// ones on by their period (from now on if the loop fell behind by more than one), count down to
+// the next one
+//========================================================================================================
+
+static void eventTimerService(Event *event) {
+    unsigned long long now = idleNow();
+    EventTimer *timer;
+
+    while (eventTimers && eventTimers->due <= now) {
+        timer = eventTimers;
+        eventTimers = timer->next;
+        timer->armed = 0;
+        if (timer->period) {
+            timer->due += timer->period;
+            if (timer->due <= now) {
+                timer->due = now + timer->period;
+            }
+            eventTimerInsert(timer);
+        }
+        eventPost(&timer->event);
+    }
+    eventTimerArm();
+    (void)event;
+}
+
+//========================================================================================================
+// Timeout of Timer 0: clear it and hand over to the main loop
+//========================================================================================================
+
+void EventTimerHandler(void) {
+    TIMER0_ICR_R = 0x1;
+    eventPost(&eventTick);
+}
+
+//========================================================================================================
+// Figures of a priority. Main loop only.
+//========================================================================================================
+
+void eventGet(unsigned int priority, EventStats *out) {
+    EventQueue *q = &eventQueues[priority % EVENT_PRIORITIES];
+
+    out->latency = q->latency;
+    out->run = q->run;
+    out->dropped = q->dropped;
+}
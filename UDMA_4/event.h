@@ -0,0 +1,135 @@
+//======================================================================================================
+// Cooperative event loop with prioritized run-to-completion handlers
+//======================================================================================================
+// Interrupt handlers only take their data off the hardware and post an event (eventPost()); the
+// work that follows (decoding, CRC, echo, reports) runs in the handler of the event, from the main
+// loop, outside of interrupt context. An event is a static object with a handler and a priority:
+// - EVENT_PRIO_HIGH: short work that keeps the hardware busy, e.g. the next submit after TX done,
+// - EVENT_PRIO_NORMAL: processing of received frames,
+// - EVENT_PRIO_LOW: background work, e.g. the periodic reports of timers.
+//
+// Every priority has its own queue. eventRun() takes the oldest event of the highest priority that
+// has one, runs its handler to completion and starts over, so an event posted meanwhile by an
+// interrupt handler is taken before anything of lower priority; it returns when all queues are
+// empty. An event is in a queue at most once: posting it again while it waits is counted as
+// coalesced and its handler runs once. Its pending flag is cleared right before the handler runs,
+// so a post from then on queues it again.
+//
+// eventPost() may be called from any context, including nested interrupts: the pending flag and
+// the head of a queue are claimed with atomicSwap() (see atomic.h), as in log.c. Everything else
+// runs in the main loop only.
+//
+// Timers (EventTimer): one-shot or periodic, in microseconds. Timer 0 (GPTM0) counts down to the
+// earliest due time in one-shot mode; its interrupt posts an internal event of EVENT_PRIO_HIGH
+// that posts the event of every timer that has expired and starts the count to the next one. The
+// timer keeps its clock while the CPU sleeps (SCGCTIMER, see idle.h), and nothing runs while no
+// timer is due.
+//
+// eventWait() sleeps until the next interrupt unless an event is pending. Interrupts are masked
+// around the check and the WFI (a pending interrupt still ends the WFI), so a post between the
+// check and the sleep cannot be missed; the handler runs when they are unmasked again.
+//
+// For every priority the latency from eventPost() to the start of the handler and the run time of
+// the handlers are kept, in system clock cycles on the SysTick time of idleNow() (idleInit() has to
+// come first), as TraceStats (see trace.h). The latency of an event is bounded by the run time of
+// the handlers of higher or equal priority that are queued before it and of the one running.
+//
+// Usage:
+// static void rxWork(Event *event);
+// Event rxEvent = EVENT_INIT(rxWork, EVENT_PRIO_NORMAL, 0);
+// ISR:       eventPost(&rxEvent);
+// main loop: eventInit(); ... while (1) { eventRun(); eventWait(); }
+//======================================================================================================
+
+#ifndef EVENT_H
+#define EVENT_H
+
+#include "trace.h"
+
+#define EVENT_PRIORITIES 3
+#define EVENT_PRIO_HIGH 0
+#define EVENT_PRIO_NORMAL 1
+#define EVENT_PRIO_LOW 2
+
+#define EVENT_QUEUE_LEN 16      // events per priority, must be a power of two
+
+typedef struct Event Event;
+
+typedef void (*EventHandler)(Event *event);
+
+struct Event {
+    EventHandler handler;
+    void *context;
+    unsigned int priority;              // EVENT_PRIO_*
+    volatile unsigned int pending;      // in a queue
+    volatile unsigned long long posted; // idleNow() at the post
+    volatile unsigned int posts;        // posts that queued the event
+    volatile unsigned int coalesced;    // posts while it was already queued
+    unsigned int runs;
+};
+
+#define EVENT_INIT(handler, priority, context) { (handler), (context), (priority), 0, 0, 0, 0, 0 }
+
+//========================================================================================================
+// Timer: event is posted at every expiry. The handler may cast its Event back to the EventTimer.
+//========================================================================================================
+
+typedef struct EventTimer EventTimer;
+
+struct EventTimer {
+    Event event;
+    unsigned long long due;     // idleNow() time of the next expiry
+    unsigned long long period;  // cycles, 0: one-shot
+    EventTimer *next;           // armed timers, earliest first
+    int armed;
+};
+
+//========================================================================================================
+// Task: a handler that waits for conditions, e.g. the completion of asynchronous operations (see
+// uart.h). TASK_AWAIT() returns from the handler while cond is false and resumes there at the next
+// run, when the event has been posted again (by the completion handler of the operation). Locals do
+// not survive a wait: keep state in statics or the context. No TASK_AWAIT() inside a switch.
+// static void work(Event *event) {
+//     EventTask *task = (EventTask *)event;
+//     TASK_BEGIN(task);
+//     ...
+//     TASK_AWAIT(task, uartOpDone(&op));
+//     ...
+//     TASK_END(task);
+// }
+//========================================================================================================
+
+typedef struct {
+    Event event;
+    unsigned int line;          // where to resume, 0: at the start
+} EventTask;
+
+#define EVENT_TASK_INIT(handler, priority, context) { EVENT_INIT(handler, priority, context), 0 }
+
+#define TASK_BEGIN(task) switch ((task)->line) { case 0:
+#define TASK_AWAIT(task, cond) do { (task)->line = __LINE__; case __LINE__: \
+                                    if (!(cond)) { return; } } while (0)
+#define TASK_END(task) } (task)->line = 0
+
+//========================================================================================================
+// Figures of one priority
+//========================================================================================================
+
+typedef struct {
+    TraceStats latency;         // eventPost() to the start of the handler, system clock cycles
+    TraceStats run;             // handler start to return, system clock cycles
+    unsigned int dropped;       // posts that found the queue full
+} EventStats;
+
+void eventInit(void);
+int eventPost(Event *event);
+int eventRunOne(void);
+void eventRun(void);
+int eventPending(void);
+void eventWait(void);
+void eventTimerStart(EventTimer *timer, unsigned int us, unsigned int periodUs);
+void eventTimerStop(EventTimer *timer);
+void eventGet(unsigned int priority, EventStats *out);
+void EventTimerHandler(void);
+
+#endif // EVENT_H
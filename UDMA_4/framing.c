@@ -0,0 +1,279 @@
+//======================================================================================================
+// Streaming COBS and SLIP framing
+//======================================================================================================
+
+#include <stdint.h>
+#include <string.h>
+#include "framing.h"
+
+//========================================================================================================
+// Word-at-a-time byte search:
+// w ^ (a * 0x01010101) has a zero byte where w holds a. A word has a zero byte if subtracting 1
+// from every byte borrows into a top bit that was clear before: (w - 0x01010101) & ~w & 0x80808080
+// is not 0. Bytes before the first aligned word and after the last one are tested one by one. The
+// words are loaded with memcpy(), which compiles to one LDR and does not read the bytes through a
+// uint32_t lvalue.
+//========================================================================================================
+
+#define HAS_ZERO(w) (((w) - 0x01010101u) & ~(w) & 0x80808080u)
+
+//========================================================================================================
+// Index of the first byte in data that equals a or b, len if there is none
+//========================================================================================================
+
+unsigned int frameFind(const unsigned char *data, unsigned int len, unsigned char a,
+                       unsigned char b) {
+    uint32_t ma = a * 0x01010101u;
+    uint32_t mb = b * 0x01010101u;
+    unsigned int i = 0;
+    uint32_t w;
+
+    while (i < len && ((uintptr_t)&data[i] & 3) != 0) {
+        if (data[i] == a || data[i] == b) {
+            return i;
+        }
+        i++;
+    }
+    while (i + 4 <= len) {
+        memcpy(&w, &data[i], 4);
+        if (HAS_ZERO(w ^ ma) | HAS_ZERO(w ^ mb)) {
+            break;
+        }
+        i += 4;
+    }
+    while (i < len && data[i] != a && data[i] != b) {
+        i++;
+    }
+    return i;
+}
+
+//========================================================================================================
+// Decoder
+//========================================================================================================
+
+void frameDecoderInit(FrameDecoder *d, unsigned char *out, unsigned int max, FrameHandler handler,
+                      void *context) {
+    d->out = out;
+    d->max = max;
+    d->len = 0;
+    d->code = 0;
+    d->left = 0;
+    d->discard = 0;
+    d->handler = handler;
+    d->context = context;
+    d->frames = 0;
+    d->errors = 0;
+}
+
+//========================================================================================================
+// Append decoded bytes to the frame, or give it up when they do not fit
+//========================================================================================================
+
+static void frameAppend(FrameDecoder *d, const unsigned char *data, unsigned int len) {
+    unsigned int i;
+
+    if (d->discard) {
+        return;
+    }
+    if (len > d->max - d->len) {
+        d->discard = 1;
+        return;
+    }
+    for (i = 0; i < len; i++) {
+        d->out[d->len + i] = data[i];
+    }
+    d->len += len;
+}
+
+//========================================================================================================
+// Delimiter: pass the frame on, drop it if broken, ignore it if empty. Start the next one.
+//========================================================================================================
+
+static void frameEnd(FrameDecoder *d) {
+    if (d->discard) {
+        d->errors++;
+    } else if (d->len != 0) {
+        d->frames++;
+        if (d->handler) {
+            d->handler(d->context, d->out, d->len);
+        }
+    }
+    d->len = 0;
+    d->code = 0;
+    d->left = 0;
+    d->discard = 0;
+}
+
+//========================================================================================================
+// COBS: between blocks a code byte c is read: 0 is the delimiter, otherwise c - 1 data bytes follow.
+// Every block but one of 254 data bytes (c = 0xFF) stood for a zero after its data, which is only
+// appended once the next block shows that the frame goes on. A zero inside a block means that the
+// frame broke off: it is dropped and the zero starts the next one.
+//========================================================================================================
+
+void cobsDecode(FrameDecoder *d, const unsigned char *data, unsigned int len) {
+    static const unsigned char zero = 0;
+    const unsigned char *end = data + len;
+    unsigned int n, run;
+
+    while (data < end) {
+        if (d->left == 0) {
+            if (*data == 0) {
+                frameEnd(d);
+            } else {
+                if (d->code != 0 && d->code != 0xFF) {
+                    frameAppend(d, &zero, 1);
+                }
+                d->code = *data;
+                d->left = *data - 1;
+            }
+            data++;
+            continue;
+        }
+        n = (unsigned int)(end - data) < d->left ? (unsigned int)(end - data) : d->left;
+        run = frameFind(data, n, 0, 0);
+        frameAppend(d, data, run);
+        data += run;
+        d->left -= run;
+        if (run < n) {
+            d->discard = 1;
+            frameEnd(d);
+            data++;
+        }
+    }
+}
+
+//========================================================================================================
+// SLIP: plain bytes up to the next END or ESC are copied as a run. The byte after ESC is ESC_END or
+// ESC_ESC; anything else breaks the frame.
+//========================================================================================================
+
+void slipDecode(FrameDecoder *d, const unsigned char *data, unsigned int len) {
+    const unsigned char *end = data + len;
+    unsigned char c;
+    unsigned int run;
+
+    while (data < end) {
+        if (d->code) {
+            c = *data++;
+            d->code = 0;
+            if (c == SLIP_ESC_END) {
+                c = SLIP_END;
+            } else if (c == SLIP_ESC_ESC) {
+                c = SLIP_ESC;
+            } else {
+                d->discard = 1;
+            }
+            frameAppend(d, &c, 1);
+            continue;
+        }
+        run = frameFind(data, end - data, SLIP_END, SLIP_ESC);
+        frameAppend(d, data, run);
+        data += run;
+        if (data == end) {
+            break;
+        }
+        if (*data++ == SLIP_END) {
+            frameEnd(d);
+        } else {
+            d->code = 1;
+        }
+    }
+}
+
+//========================================================================================================
+// Encoder
+//========================================================================================================
+
+void frameEncoderInit(FrameEncoder *e, unsigned char *out, unsigned int max) {
+    e->out = out;
+    e->max = max;
+    e->len = 0;
+    e->codeAt = 0;
+    e->overflow = 0;
+}
+
+static void framePut(FrameEncoder *e, unsigned char c) {
+    if (e->len < e->max) {
+        e->out[e->len++] = c;
+    } else {
+        e->overflow = 1;
+    }
+}
+
+//========================================================================================================
+// COBS: a block is opened with a placeholder for its code byte, which is filled in when the block
+// is closed by a zero in the data, by reaching 254 data bytes or by the end of the frame.
+//========================================================================================================
+
+static void cobsOpen(FrameEncoder *e) {
+    e->codeAt = e->len;
+    framePut(e, 0);
+}
+
+static void cobsClose(FrameEncoder *e) {
+    if (e->codeAt < e->max) {
+        e->out[e->codeAt] = e->len - e->codeAt;
+    }
+}
+
+void cobsEncodeStart(FrameEncoder *e) {
+    cobsOpen(e);
+}
+
+void cobsEncodeFeed(FrameEncoder *e, const unsigned char *data, unsigned int len) {
+    unsigned int i;
+
+    for (i = 0; i < len; i++) {
+        if (data[i] == 0) {
+            cobsClose(e);
+            cobsOpen(e);
+            continue;
+        }
+        framePut(e, data[i]);
+        if (e->len - e->codeAt == 0xFF) {
+            cobsClose(e);
+            cobsOpen(e);
+        }
+    }
+}
+
+//========================================================================================================
+// Close the last block and append the delimiter. Returns the length of the encoded frame, -1 if it
+// did not fit.
+//========================================================================================================
+
+int cobsEncodeEnd(FrameEncoder *e) {
+    cobsClose(e);
+    framePut(e, 0);
+    return e->overflow ? -1 : (int)e->len;
+}
+
+//========================================================================================================
+// SLIP: a leading END flushes whatever line noise the receiver has collected
+//========================================================================================================
+
+void slipEncodeStart(FrameEncoder *e) {
+    framePut(e, SLIP_END);
+}
+
+void slipEncodeFeed(FrameEncoder *e, const unsigned char *data, unsigned int len) {
+    unsigned int i;
+
+    for (i = 0; i < len; i++) {
+        if (data[i] == SLIP_END) {
+            framePut(e, SLIP_ESC);
+            framePut(e, SLIP_ESC_END);
+        } else if (data[i] == SLIP_ESC) {
+            framePut(e, SLIP_ESC);
+            framePut(e, SLIP_ESC_ESC);
+        } else {
+            framePut(e, data[i]);
+        }
+    }
+}
+
+int slipEncodeEnd(FrameEncoder *e) {
+    framePut(e, SLIP_END);
+    return e->overflow ? -1 : (int)e->len;
+}
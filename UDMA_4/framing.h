@@ -0,0 +1,91 @@
+//======================================================================================================
+// Streaming COBS and SLIP framing
+//======================================================================================================
+// Binary frames on a byte stream, encoded either way:
+// - COBS (consistent overhead byte stuffing): the frame is cut at its zero bytes into blocks, each
+//   led by a code byte that gives the distance to the next zero. The encoded frame contains no
+//   zero; a single 0x00 ends it. Overhead: one byte per 254 bytes plus the delimiter.
+// - SLIP (RFC 1055): END (0xC0) ends a frame, END and ESC (0xDB) inside the frame are sent as
+//   ESC ESC_END (0xDC) and ESC ESC_ESC (0xDD). Up to twice the length in the worst case.
+//
+// The decoders take the stream in chunks of any size, as the UART driver hands them over, and keep
+// their state between chunks, so every byte is looked at once. Runs of plain bytes are found with
+// a word-at-a-time search for the delimiter (and for SLIP the escape byte): four bytes are tested
+// with three ALU operations per pattern instead of one compare and branch per byte. The decoded
+// bytes go into a frame buffer of the caller; a complete frame is passed to the handler, and is
+// valid until the next call of the decoder. A frame that does not fit or breaks off (COBS: a zero
+// inside a block) is dropped and counted in errors.
+//
+// The encoders likewise take a frame in pieces: Start, any number of Feed calls, End.
+//
+// Usage:
+// frameDecoderInit(&d, frame, sizeof(frame), frameReady, 0);
+// cobsDecode(&d, chunk, len);          // for every chunk received
+//
+// frameEncoderInit(&e, out, sizeof(out));
+// cobsEncodeStart(&e);
+// cobsEncodeFeed(&e, header, 4);
+// cobsEncodeFeed(&e, payload, 32);
+// len = cobsEncodeEnd(&e);             // -1 if out was too small
+//======================================================================================================
+
+#ifndef FRAMING_H
+#define FRAMING_H
+
+//========================================================================================================
+// Longest encoding of a frame of n bytes, delimiters included
+//========================================================================================================
+
+#define COBS_MAX(n) ((n) + (n)/254 + 2)
+#define SLIP_MAX(n) (2*(n) + 2)
+
+#define SLIP_END 0xC0
+#define SLIP_ESC 0xDB
+#define SLIP_ESC_END 0xDC
+#define SLIP_ESC_ESC 0xDD
+
+//========================================================================================================
+// Called with every complete frame
+//========================================================================================================
+
+typedef void (*FrameHandler)(void *context, unsigned char *frame, unsigned int len);
+
+typedef struct {
+    unsigned char *out;         // frame being decoded
+    unsigned int max;           // size of out
+    unsigned int len;           // bytes of the frame so far
+    unsigned int code;          // COBS: code byte of the current block (0: none yet)
+                                // SLIP: 1 after ESC
+    unsigned int left;          // COBS: data bytes left in the current block
+    int discard;                // the frame is broken, skip to the next delimiter
+    FrameHandler handler;
+    void *context;
+    unsigned int frames;        // frames passed to the handler
+    unsigned int errors;        // frames dropped
+} FrameDecoder;
+
+typedef struct {
+    unsigned char *out;
+    unsigned int max;           // size of out
+    unsigned int len;           // bytes written to out
+    unsigned int codeAt;        // COBS: position of the code byte of the current block
+    int overflow;               // out was too small
+} FrameEncoder;
+
+void frameDecoderInit(FrameDecoder *d, unsigned char *out, unsigned int max, FrameHandler handler,
+                      void *context);
+void cobsDecode(FrameDecoder *d, const unsigned char *data, unsigned int len);
+void slipDecode(FrameDecoder *d, const unsigned char *data, unsigned int len);
+
+void frameEncoderInit(FrameEncoder *e, unsigned char *out, unsigned int max);
+void cobsEncodeStart(FrameEncoder *e);
+void cobsEncodeFeed(FrameEncoder *e, const unsigned char *data, unsigned int len);
+int cobsEncodeEnd(FrameEncoder *e);
+void slipEncodeStart(FrameEncoder *e);
+void slipEncodeFeed(FrameEncoder *e, const unsigned char *data, unsigned int len);
+int slipEncodeEnd(FrameEncoder *e);
+
+unsigned int frameFind(const unsigned char *data, unsigned int len, unsigned char a,
+                       unsigned char b);
+
+#endif // FRAMING_H
@@ -0,0 +1,78 @@
+//======================================================================================================
+// Register access by address, core registers shared by the drivers and CPU instructions
+//======================================================================================================
+// The device header names the registers of every instance (UART0_DR_R, TIMER1_CTL_R, ...). Drivers
+// that serve several instances from a table (the UART links, the timers that pace them or trigger
+// the ADC, ...) reach theirs through HWREG() at base + offset instead, and the NVIC registers that
+// take one bit per interrupt at register + 4*(irq/32).
+// The host build of the device header (sim/inc) brings its own HWREG, __WFI(), __disable_irq(),
+// __enable_irq() and __DSB(); the definitions here are for the target only.
+//======================================================================================================
+
+#ifndef HW_H
+#define HW_H
+
+#include <stdint.h>
+#include "inc/tm4c1294ncpdt.h"
+
+#ifndef HWREG
+#define HWREG(x) (*((volatile uint32_t *)(x)))
+#endif
+
+//========================================================================================================
+// NVIC interrupt set enable, clear enable and set pending registers
+//========================================================================================================
+
+#define NVIC_EN 0xE000E100
+#define NVIC_DIS 0xE000E180
+#define NVIC_PEND 0xE000E200
+
+//========================================================================================================
+// Timer blocks and the register offsets that every user of a timer needs
+//========================================================================================================
+
+#define GPTM_BASE 0x40030000   // Timer n at GPTM_BASE + n * 0x1000
+#define GPTM_TIMERS 8
+#define GPTM_CFG 0x000
+#define GPTM_TAMR 0x004
+#define GPTM_CTL 0x00C
+#define GPTM_TAILR 0x028
+
+//========================================================================================================
+// GPIO register offsets for the pins of a peripheral
+//========================================================================================================
+
+#define GPIO_AFSEL 0x420
+#define GPIO_DEN 0x51C
+
+//========================================================================================================
+// Wait for interrupt, interrupt mask (CPSID I / CPSIE I) and data synchronization barrier
+//========================================================================================================
+
+#ifndef __WFI
+#if defined(__TI_ARM__)
+#define __WFI() __asm(" wfi")
+#else
+#define __WFI() __asm volatile ("wfi")
+#endif
+#endif
+
+#ifndef __disable_irq
+#if defined(__TI_ARM__)
+#define __disable_irq() __asm(" cpsid i")
+#define __enable_irq() __asm(" cpsie i")
+#else
+#define __disable_irq() __asm volatile ("cpsid i" ::: "memory")
+#define __enable_irq() __asm volatile ("cpsie i" ::: "memory")
+#endif
+#endif
+
+#ifndef __DSB
+#if defined(__TI_ARM__)
+#define __DSB() __asm(" dsb")
+#else
+#define __DSB() __asm volatile ("dsb")
+#endif
+#endif
+
+#endif // HW_H
@@ -0,0 +1,131 @@
+//======================================================================================================
+// Sleep on idle and CPU duty cycle
+//======================================================================================================
+
+#include "inc/tm4c1294ncpdt.h"
+#include "clock.h"
+#include "hw.h"
+#include "idle.h"
+#include "log.h"
+#include "vector.h"
+
+#define SYSTICK_PERIOD 0x01000000   // RELOAD + 1
+
+static volatile unsigned int idleWraps;     // SysTick periods since idleInit()
+static unsigned long long idleStart;
+static unsigned long long idleSlept;
+static unsigned int idleWakeups;
+static unsigned long long idleLastReport;
+static IdleStats idleLast;
+
+//========================================================================================================
+// Start sleep on idle:
+// NVIC_SYS_CTRL:
+// SLEEPDEEP = 0 => WFI enters sleep mode, SLEEPEXIT = 0 => return to the main loop after each ISR
+// RSCLKCFG:
+// ACG = 1 => the SCGC registers decide which peripherals run while the CPU sleeps
+// NVIC_ST_RELOAD/NVIC_ST_CURRENT/NVIC_ST_CTRL:
+// SysTick free running over 24 bits on the system clock, its exception counts the periods
+// (SysTickHandler(), installed in the vector table, see vector.h)
+//========================================================================================================
+
+void idleInit(void) {
+    NVIC_SYS_CTRL_R &= ~0x06;
+    SYSCTL_RSCLKCFG_R |= (1<<29);
+
+    NVIC_ST_CTRL_R = 0;
+    vectorRegister(VECTOR_SYSTICK, SysTickHandler);
+    NVIC_ST_RELOAD_R = SYSTICK_PERIOD - 1;
+    NVIC_ST_CURRENT_R = 0;
+    idleWraps = 0;
+    NVIC_ST_CTRL_R = 0x07;
+
+    idleStart = idleNow();
+    idleSlept = 0;
+    idleWakeups = 0;
+    idleLastReport = idleStart;
+    idleGet(&idleLast);
+}
+
+//========================================================================================================
+// SysTick exception: one more period of 2^24 cycles
+//========================================================================================================
+
+void SysTickHandler(void) {
+    idleWraps++;
+}
+
+//========================================================================================================
+// System clock cycles since SysTick was started. The period count is read again after the counter
+// so that a wrap in between is not missed.
+// Inside an interrupt handler the SysTick exception cannot run: a wrap it has not counted yet shows
+// as PENDSTSET (bit 26 of NVIC_INT_CTRL) with the counter reloaded to the top half of the period.
+//========================================================================================================
+
+unsigned long long idleNow(void) {
+    unsigned int wraps, current, pending;
+
+    do {
+        wraps = idleWraps;
+        current = NVIC_ST_CURRENT_R;
+        pending = NVIC_INT_CTRL_R & (1u<<26);
+    } while (wraps != idleWraps);
+    if (pending && current >= SYSTICK_PERIOD / 2) {
+        wraps++;
+    }
+    return (unsigned long long)wraps * SYSTICK_PERIOD + (SYSTICK_PERIOD - 1 - current);
+}
+
+//========================================================================================================
+// Sleep until the next interrupt
+//========================================================================================================
+
+void idleSleep(void) {
+    unsigned long long t = idleNow();
+
+    __WFI();
+    idleSlept += idleNow() - t;
+    idleWakeups++;
+}
+
+//========================================================================================================
+// Totals since idleInit()
+//========================================================================================================
+
+void idleGet(IdleStats *stats) {
+    stats->total = idleNow() - idleStart;
+    stats->sleep = idleSlept;
+    stats->wakeups = idleWakeups;
+}
+
+//========================================================================================================
+// Share of the time the CPU was awake, in parts per million
+//========================================================================================================
+
+unsigned int idleAwakePpm(const IdleStats *stats) {
+    if (stats->total == 0) {
+        return 0;
+    }
+    return (unsigned int)(((stats->total - stats->sleep) * 1000000) / stats->total);
+}
+
+//========================================================================================================
+// Called from the main loop: every IDLE_REPORT_MS the duty cycle and the wake-ups of the last
+// period go to the log.
+//========================================================================================================
+
+void idleReport(void) {
+    unsigned long long now = idleNow();
+    IdleStats all, period;
+
+    if (now - idleLastReport < (unsigned long long)clockGet() / 1000 * IDLE_REPORT_MS) {
+        return;
+    }
+    idleLastReport = now;
+    idleGet(&all);
+    period.total = all.total - idleLast.total;
+    period.sleep = all.sleep - idleLast.sleep;
+    period.wakeups = all.wakeups - idleLast.wakeups;
+    idleLast = all;
+    logWrite(LOG_IDLE, idleAwakePpm(&period), period.wakeups);
+}
@@ -0,0 +1,43 @@
+//======================================================================================================
+// Sleep on idle and CPU duty cycle
+//======================================================================================================
+// The main loop calls idleSleep() when it has nothing left to do. The CPU executes WFI and sleeps
+// until the next interrupt, while the uDMA keeps moving UART data. Sleep mode is used, not deep
+// sleep: deep sleep would stop the PLL and with it the baud rate clock.
+//
+// idleInit() turns on auto clock gating (ACG in RSCLKCFG), so while the CPU sleeps only the
+// peripherals enabled in the SCGC registers keep their clock. Drivers enable their own blocks in
+// SCGC/DCGC when they start (uDMA in udmaInit(), UART and GPIO port in uartOpen()).
+//
+// Time is measured with SysTick on the system clock, which runs in sleep mode. The SysTick
+// exception extends the 24 bit counter every 2^24 cycles (140 ms at 120 MHz). The time spent in
+// WFI is the sleep time; the interrupt handlers that end a sleep are counted as sleep too, so the
+// duty cycle is that of the main loop plus the interrupt entry of each wake-up. When the sleep is
+// entered with interrupts masked (eventWait(), see event.h), the handlers run after idleSleep()
+// has returned and count as awake.
+//======================================================================================================
+
+#ifndef IDLE_H
+#define IDLE_H
+
+//========================================================================================================
+// Period of the duty cycle entries written to the log by idleReport()
+//========================================================================================================
+
+#define IDLE_REPORT_MS 1000
+
+typedef struct {
+    unsigned long long total;   // SysTick cycles since idleInit()
+    unsigned long long sleep;   // cycles spent in WFI
+    unsigned int wakeups;       // WFI executed
+} IdleStats;
+
+void idleInit(void);
+void idleSleep(void);
+unsigned long long idleNow(void);
+void idleGet(IdleStats *stats);
+unsigned int idleAwakePpm(const IdleStats *stats);
+void idleReport(void);
+void SysTickHandler(void);
+
+#endif // IDLE_H
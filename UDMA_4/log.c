@@ -0,0 +1,98 @@
+//======================================================================================================
+// Deferred binary log
+//======================================================================================================
+
+#include <stdio.h>
+#include "atomic.h"
+#include "log.h"
+
+//========================================================================================================
+// Formats, indexed by the LOG_* ids. Every format takes exactly two unsigned int arguments.
+//========================================================================================================
+
+static const char * const logFormats[] = {
+    "DMA transfer is done...\n",                        // LOG_TX_DONE
+    "DMA channel conflict... peripheral %u, channel %u taken\n", // LOG_DMA_CONFLICT
+    "Idle... cpu awake %u ppm, %u wake-ups\n",     // LOG_IDLE
+    "Frame decoded... %u bytes, %u frames dropped so far\n", // LOG_RX_DECODED
+    "Frame CRC error... %u bytes, CRC 0x%08X received\n", // LOG_RX_CRC_ERROR
+    "Receive error... uart%u, status 0x%X\n",      // LOG_UART_ERROR
+    "ADC overflow... sequencer %u, %u overflows so far\n", // LOG_ADC_OVERFLOW
+};
+
+#define LOG_FORMATS (sizeof(logFormats)/sizeof(logFormats[0]))
+
+//========================================================================================================
+// Ring entry. seq is written last and holds the claimed index + 1 once the entry is complete.
+//========================================================================================================
+
+typedef struct {
+    volatile unsigned int seq;
+    volatile unsigned int id;
+    volatile unsigned int a;
+    volatile unsigned int b;
+} LogEntry;
+
+static LogEntry logRing[LOG_ENTRIES];
+static volatile unsigned int logHead;       // next index to claim (producers)
+static volatile unsigned int logTail;       // next index to print (main loop)
+static volatile unsigned int logDropped;
+static unsigned int logDroppedReported;
+
+//========================================================================================================
+// Append an entry. Safe to call from interrupt context.
+//========================================================================================================
+
+void logWrite(unsigned int id, unsigned int a, unsigned int b) {
+    unsigned int head, dropped;
+    LogEntry *e;
+
+    do {
+        head = logHead;
+        if (head - logTail >= LOG_ENTRIES) {
+            do {
+                dropped = logDropped;
+            } while (!atomicSwap(&logDropped, dropped, dropped + 1));
+            return;
+        }
+    } while (!atomicSwap(&logHead, head, head + 1));
+
+    e = &logRing[head & (LOG_ENTRIES-1)];
+    e->id = id;
+    e->a = a;
+    e->b = b;
+    e->seq = head + 1;
+}
+
+//========================================================================================================
+// Print all complete entries. Called from the main loop only. Returns the number of entries printed.
+//========================================================================================================
+
+unsigned int logDrain(void) {
+    unsigned int printed = 0;
+    unsigned int dropped;
+
+    while (logTail != logHead) {
+        LogEntry *e = &logRing[logTail & (LOG_ENTRIES-1)];
+        unsigned int id, a, b;
+
+        if (e->seq != logTail + 1) {
+            break;                  // claimed but not yet written
+        }
+        id = e->id;
+        a = e->a;
+        b = e->b;
+        logTail = logTail + 1;
+        if (id < LOG_FORMATS) {
+            printf(logFormats[id], a, b);
+        }
+        printed++;
+    }
+
+    dropped = logDropped;
+    if (dropped != logDroppedReported) {
+        printf("log: %u entries dropped\n", dropped - logDroppedReported);
+        logDroppedReported = dropped;
+    }
+    return printed;
+}
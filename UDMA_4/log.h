@@ -0,0 +1,38 @@
+//======================================================================================================
+// Deferred binary log
+//======================================================================================================
+// printf goes through the CCS CIO path and halts the CPU for milliseconds, which is far too long
+// for an ISR. logWrite() instead stores a format id and two argument words into a ring buffer
+// (a handful of stores, no formatting) and returns. logDrain() is called from the main loop and
+// prints the pending entries with printf.
+//
+// logWrite() may be called from any context, including nested interrupts: a slot is claimed with
+// atomicSwap() (see atomic.h) and published by writing its sequence number last. When the ring is
+// full the entry is dropped and counted.
+//======================================================================================================
+
+#ifndef LOG_H
+#define LOG_H
+
+//========================================================================================================
+// Ring size, must be a power of two
+//========================================================================================================
+
+#define LOG_ENTRIES 64
+
+//========================================================================================================
+// Format ids, see logFormats[] in log.c
+//========================================================================================================
+
+#define LOG_TX_DONE 0       // a, b: unused
+#define LOG_DMA_CONFLICT 1  // a: peripheral (UDMA_UART_RX(n), ...), b: channel already taken
+#define LOG_IDLE 2          // a: CPU awake in ppm of the period, b: wake-ups
+#define LOG_RX_DECODED 3    // a: length of a decoded frame without CRC, b: frames dropped by the decoder
+#define LOG_RX_CRC_ERROR 4  // a: length of the frame without CRC, b: CRC received
+#define LOG_UART_ERROR 5    // a: UART number, b: UART_ERR_* bits
+#define LOG_ADC_OVERFLOW 6  // a: sample sequencer, b: overflows so far
+
+void logWrite(unsigned int id, unsigned int a, unsigned int b);
+unsigned int logDrain(void);
+
+#endif // LOG_H
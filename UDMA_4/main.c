@@ -9,8 +9,9 @@
 // Interrupts are desirable in microcontroller designs because they make efficient use of the
 // processor. The processor only needs to service ISR from different peripherals. When there are
 // ISR the processor can be put to sleep thus saving energy.
-// The testing of this code is done with Realterm. The speed of the communication line is 115200MHz
-// and a 8N1 format. The debugging is done in code composer studio.
+// The testing of this code is done with Realterm. The speed of the communication line is 115200 bit/s
+// (UART2_BAUD) and a 8N1 format. The CPU runs at 120 MHz from the PLL (see clock.h). The
+// debugging is done in code composer studio.
 // TIVA TM4C1294XL uses a single channel for both Tx and Rx interrupts. Software has to determine what
 // causes the interrupt by using the MIS.
 //========================================================================================================
@@ -21,25 +22,70 @@
 
 #include "inc/tm4c1294ncpdt.h"
 #include <stdint.h>
-#include <stdio.h>
+#include "adc.h"
+#include "clock.h"
+#include "crc.h"
+#include "dmaCopy.h"
+#include "event.h"
+#include "framing.h"
+#include "idle.h"
+#include "log.h"
+#include "pool.h"
+#include "trace.h"
+#include "uart.h"
+#include "udma.h"
+#include "vector.h"
 
 //========================================================================================================
-// COntrol table length
+// Speed of UART2 in bit/s. Any rate up to SysClk/8 (15 Mbaud at 120 MHz) can be used, the
+// peer has to use the same rate.
 //========================================================================================================
 
-#define LEN 256
+#define UART2_BAUD 115200
 
 //========================================================================================================
-// Receive buffer
+// RTS/CTS on PD6/PD7 (see uartFlowControl()). Only set to 1 when the peer has them wired: with CTS
+// left open, UART2 would never transmit.
 //========================================================================================================
 
-unsigned char rxBuffer[LEN];
+#define UART2_FLOW 0
 
 //========================================================================================================
-// Control table
+// FIFO trigger levels of UART2, each with the largest uDMA burst it allows (see uartDmaTune()). In the
+// sweep of sim/benchMain.c (make bench) half full levels with bursts of 8 bytes move the frames at
+// line rate with the fewest uDMA arbitrations; higher RX levels leave more bytes for the receive
+// timeout to drain at the end of a frame.
 //========================================================================================================
 
-unsigned int controlTable[LEN];
+#define UART2_RX_FIFO UART_FIFO_1_2
+#define UART2_TX_FIFO UART_FIFO_1_2
+
+//========================================================================================================
+// Paced transmit of UART2 (see uartPace()): bytes per second, 0 = as fast as the line takes them.
+// A receiver that cannot keep up with the line rate of 11520 bytes/s gets UART2_PACE_BURST bytes
+// at a time, spaced evenly by Timer 2 (uDMA channel 4), e.g. 2880 for a quarter of the line rate.
+//========================================================================================================
+
+#define UART2_PACE_BPS 0
+#define UART2_PACE_TIMER 2
+#define UART2_PACE_BURST 8
+
+//========================================================================================================
+// ADC stream on UART2 (see adc.h): AIN<ADC_STREAM_INPUT> (PE3 for AIN0) at ADC_STREAM_HZ samples per
+// second, triggered by Timer ADC_STREAM_TIMER and sent between the echoes in blocks of
+// ADC_BLOCK_SAMPLES samples. 0 = off: the stream takes about 2.07 bytes/s per sample/s of the
+// 11520 bytes/s of the line, which the echo of a busy peer already fills; e.g. 2000 on a quiet line.
+//========================================================================================================
+
+#define ADC_STREAM_HZ 0
+#define ADC_STREAM_INPUT 0
+#define ADC_STREAM_TIMER 1
+
+//========================================================================================================
+// UART2 link (driver state, TX queue and statistics)
+//========================================================================================================
+
+Uart link2;
 
 //========================================================================================================
 // Extract of the raven by allan e. poe
@@ -48,183 +94,235 @@ unsigned int controlTable[LEN];
 
 unsigned char message[] = "Send more message if you can....";
 
+//========================================================================================================
+// Prompt and line end sent around message[] as separate segments of the transmit queue
+//========================================================================================================
+
+const unsigned char prompt[] = ">";
+const unsigned char lineEnd[] = "\r\n";
+
+//========================================================================================================
+// Received bytes of UART2, handed from the interrupt handler to the main loop as slices of pool
+// blocks (see pool.h). Nothing is copied: the main loop reads the bytes where the uDMA wrote them.
+// When the FIFO is full, further slices are dropped and counted in rxFifo.dropped.
+//========================================================================================================
+
+PoolFifo rxFifo;
+
+//========================================================================================================
+// The peer sends COBS frames (see framing.h) of up to RX_FRAME_MAX bytes. rxDecoder takes them
+// apart, slice by slice, into rxFrame. The last RX_CRC_LEN bytes of a frame are the CRC-32 of the
+// bytes before it (see crc.h), least significant byte first; frames where it does not match are
+// counted in rxCrcErrors.
+//========================================================================================================
+
+#define RX_FRAME_MAX 256
+#define RX_CRC_LEN 4
+
+static unsigned char rxFrame[RX_FRAME_MAX];
+FrameDecoder rxDecoder;
+unsigned int rxCrcErrors;
+
+//========================================================================================================
+// Slices taken from rxFifo that wait to be echoed as one message of link2.tx
+//========================================================================================================
+
+static PoolSlice echo[TX_TASKS];
+static unsigned int echoCount;
+
+//========================================================================================================
+// Sample blocks of the ADC stream, if it is on
+//========================================================================================================
+
+AdcStream adcStream;
+
+//========================================================================================================
+// Events of the main loop (see event.h), posted by the interrupt handlers and the timer:
+// - txEvent: the message on link2.tx has been sent, the next echo can go out; also posted by the
+//   ADC stream with every sample block,
+// - rxEvent: slices are waiting in rxFifo,
+// - idleTimer: every IDLE_REPORT_MS, the duty cycle goes to the log.
+//========================================================================================================
+
+void rxWork(Event *event);
+void txWork(Event *event);
+void idleWork(Event *event);
+
+Event rxEvent = EVENT_INIT(rxWork, EVENT_PRIO_NORMAL, 0);
+Event txEvent = EVENT_INIT(txWork, EVENT_PRIO_HIGH, 0);
+EventTimer idleTimer = { EVENT_INIT(idleWork, EVENT_PRIO_LOW, 0) };
+
 //=========================================================================================
-// ISR of UART2:
-// When an event happens, the ISR is executed. The processor does not know whether the Rx/Tx
-// caused the interrupt. What causes interrupt is determined from MIS. The interrupt is cleared
-// using ICR. An interrupt event is produced when Rx FIFO is 3/4 full and when the Tx FIFO is em
-// empty. During a single ISR, up to 12 character is read from Rx FIFO or up to 12 characters is
-// written into the Tx FIFO.
+// Application side of the receive path:
+// Called by the UART driver with bytes that the uDMA has just written into a pool block:
+// - the rest of a block once the uDMA has completed it (frameEnd = 0),
+// - the bytes received so far when the line went idle (frameEnd = 1), which ends a
+//   variable-length frame. A frame may thus arrive in several calls.
+// The reference to the block that comes with the bytes is passed on to the main loop
+// through rxFifo, rxEvent has it take them. Runs in interrupt context.
 //==========================================================================================
 
-void UartRxTxHandler(void) {
-    if (UART2_MIS_R & 0x01<<16) {
-        UART2_ICR_R |= (0x01<<16);
-        printf("DMA receive is done...\n");
-        rxBuffer[32] = '\0';
-        printf("Payload: %s\n", rxBuffer);
-    }
+void rxDataReady(Uart *uart, PoolBuf *buf, unsigned char *data, unsigned int len, int frameEnd) {
+    poolFifoPut(&rxFifo, buf, data, len);
+    eventPost(&rxEvent);
+}
+
+//=========================================================================================
+// Called by rxDecoder with every complete frame: check the CRC trailer
+//==========================================================================================
 
-    if (UART2_MIS_R & 0x01<<17) {
-        UART2_ICR_R |= (0x01<<17);
-        printf("DMA transfer is done...\n");
+void rxFrameReady(void *context, unsigned char *frame, unsigned int len) {
+    unsigned int sent;
+
+    if (len < RX_CRC_LEN) {
+        rxCrcErrors++;
+        logWrite(LOG_RX_CRC_ERROR, len, 0);
+        return;
+    }
+    len -= RX_CRC_LEN;
+    sent = frame[len] | (frame[len+1] << 8) | (frame[len+2] << 16)
+         | ((unsigned int)frame[len+3] << 24);
+    if (crc32(frame, len) != sent) {
+        rxCrcErrors++;
+        logWrite(LOG_RX_CRC_ERROR, len, sent);
+        return;
     }
+    logWrite(LOG_RX_DECODED, len, rxDecoder.errors);
 }
 
 //=========================================================================================
-// Configuration of UART2:
-// Assign clock and wait for uart peripheral to acquire the clock.
-// Turn of the uart peripheral for further configuation.
-// Assign a speed of 115200bps to uart peripheral
-// LCRH:
-// word length: 8
-// FEN: All FIFOs enabled
-// STP: 1 stop bit
-// EPS: Reset value
-// PEN: Parity disabled
-// BRK: No line break
+// Echo the slices taken so far on UART2 straight from their pool blocks, unless a message is
+// still being sent. The TX queue holds its own references until the echo has been sent, the
+// ones from rxFifo are dropped right away; if link2 ran short of receive blocks, uartRxKick()
+// lets it take them.
 //==========================================================================================
 
-void configUart2(void) {
-    SYSCTL_RCGCUART_R |= (1<<2);
-    while((SYSCTL_PRUART_R & (1<<2))==0);
-    UART2_CTL_R &= ~(1<<0);
-    UART2_IBRD_R = 8;
-    UART2_FBRD_R = 44;
-    UART2_LCRH_R = 0x00000070;
-    UART2_DMACTL_R |= 0x03;
-    UART2_CTL_R |= 0x311; // CTS is enabled
-
-    //===========================================================================================
-    // Configuration UART2 interrupts:
-    // IM:
-    // DMATXIM = 1 => DMATXRIS in UARTRIS is masked.
-    // DMARXIM = 1 => DMARXRIS in UARTRIS is masked.
-    // TXIM = 1 => TXRIS in UARTRIS is masked.
-    // RXIM = 1 => RXRIS in UARTRIS is masked
-    // EN1:
-    // Mask interrupt request to NVIC
-    // Re enabe uart peripheral after configuration
-    // CTL:
-    // RXE set => rx enable
-    // TXE set => tx enable
-    // UARTEN set
-    // =================================================================================================
-
-    UART2_IM_R |= 0x30030;
-    NVIC_EN1_R |= (0x1<<1);
-   // UART2_IFLS_R |= 0x18; // rx is 3/4 full and tx 3/4 empty
-    UART2_CTL_R |= 0x301; // CTS is enabled
+void echoSend(void) {
+    unsigned int n;
+
+    if (echoCount == 0 || txQueueBusy(&link2.tx)) {
+        return;
+    }
+    txQueueReset(&link2.tx);
+    for (n = 0; n < echoCount; n++) {
+        txQueueAddBuf(&link2.tx, echo[n].buf, echo[n].data, echo[n].len);
+        poolRelease(echo[n].buf);
+    }
+    echoCount = 0;
+    txQueueSubmit(&link2.tx);
+    uartRxKick(&link2);
 }
 
+//=========================================================================================
+// Main loop side of the receive path: take the slices of rxFifo while there is room for them
+// in echo[], decode the COBS frames in them and echo them. Slices that do not fit wait in
+// rxFifo for the next txEvent.
 //==========================================================================================
-// Configuration of port D for UART:
-// Assign clock to PD. Wait for clock to become stable using
-// a blocking while loop. Set alternate select of P(4) and PD(5). Set alternate function
-// of PD(4) and PD(5)to UART.
+
+void rxConsume(void) {
+    PoolSlice *slice;
+
+    while (echoCount < TX_TASKS && poolFifoGet(&rxFifo, &echo[echoCount]) == 0) {
+        slice = &echo[echoCount++];
+        cobsDecode(&rxDecoder, slice->data, slice->len);
+    }
+    echoSend();
+}
+
+void rxWork(Event *event) {
+    rxConsume();
+}
+
+//=========================================================================================
+// Send what waited for the TX queue, echo first, then the sample blocks, and take the slices
+// left in rxFifo
 //==========================================================================================
 
-void configPortD(void) {
-    SYSCTL_RCGCGPIO_R |= (1<<3);
-    while((SYSCTL_PRGPIO_R & (1<<3)) == 0);
-    GPIO_PORTD_AHB_DEN_R |= 0x030;
-    GPIO_PORTD_AHB_AFSEL_R |= 0x030;
-    GPIO_PORTD_AHB_PCTL_R |= 0x110000;
+void txWork(Event *event) {
+    echoSend();
+    if (ADC_STREAM_HZ) {
+        adcStreamSend(&adcStream, &link2);
+    }
+    if (!poolFifoEmpty(&rxFifo)) {
+        eventPost(&rxEvent);
+    }
 }
 
-//==============================================================================================
-// Configuration UART2 tx on channel 1 on rx on channel 0:
-// RCGCDMA:
-// Assigns clock to udma
-// PRDMA:
-// Wait for udma peripheral to acquire clock signal
-// CFG:
-// Enable udma controller
-// PRIOSET:
-// Sets priority of channel 1 to high. Leave channel 0 to default priority
-// ALTCLR:
-// Disables alternate control structure in both channels
-// USEBURSTCLR:
-// Enables burst transfer in both channel
-// CHAP0:
-// Select udma source i.e. uart2 tx and uart2 rx
-// CTLBASE:
-// Assign base control table
-// ENASET:
-// Enable channel 1 and 2 for use
-//=============================================================================================================
-
-void udmaConfig(void) {
-
-    SYSCTL_RCGCDMA_R |= 0x01;
-    while(!(SYSCTL_PRDMA_R & 0x01));
-    UDMA_CFG_R |= 0x01;
-    //UDMA_PRIOSET_R |= 0x02;
-    UDMA_ALTCLR_R |= 0x03;
-    UDMA_USEBURSTCLR_R |= 0x03; // enables burst on this channel
-    UDMA_REQMASKCLR_R |= 0x03;
-    UDMA_CHMAP0_R |=0x11;
-    UDMA_CTLBASE_R = (unsigned int)controlTable;
-    UDMA_ENASET_R = 0x03;
+void idleWork(Event *event) {
+    idleReport();
 }
 
-//===============================================================================================
-// COnfiguarion of base control table
-//===============================================================================================
-
-void baseTableConfig(void) {
-
-    //==============================================================================================
-    // Control structure of channel 0
-    // Control word:
-    // DSTINC = byte
-    // DSTSIZE = byte
-    // SRCINC = no increment
-    // SRCSIZE = byte
-    // ARBSIZE = 4
-    // XFERSIZE = 31
-    // XFERMODE = auto
-    //===============================================================================================
-
-    controlTable[0] = (unsigned int)&UART2_DR_R;
-    controlTable[1] = (unsigned int)&rxBuffer[31];
-    controlTable[2] = 0x0C0081F2;
-
-    //==============================================================================================
-    // Control structure of channel 1
-    // Control word:
-    // DSTINC = no increment
-    // DSTSIZE = byte
-    // SRCINC = byte
-    // SRCSIZE = byte
-    // ARBSIZE = 4
-    // XFERSIZE = 31
-    // XFERMODE = auto
-    //===============================================================================================
-
-    controlTable[4] = (unsigned int)&message[31];
-    controlTable[5] = (unsigned int)&UART2_DR_R;
-    controlTable[6] = 0xC00081F2;
+//=========================================================================================
+// Called by the UART driver when the message on link2.tx has been sent
+//==========================================================================================
 
+void txDone(Uart *uart) {
+    logWrite(LOG_TX_DONE, 0, 0);
+    eventPost(&txEvent);
 }
 
+//=========================================================================================
+// Configuration of the application:
+// System clock to 120 MHz, vector table to SRAM (the drivers install their handlers there),
+// start sleep on idle, the latency figures (trace.h) and the event loop with its timer, start
+// the uDMA controller and the copy service (software channel), the CRC engine, the buffer pool
+// and the frame decoder, open UART2 (PD4/PD5, uDMA channels 0 and 1) with its FIFO levels and
+// bursts and, if it is set, its transmit pace, start the ADC stream if it is on, queue the
+// prompt, message and line end as one scatter-gather message and start the timer of the idle
+// report.
+//==========================================================================================
+
+void appConfig(void) {
+
+    clockInit();
+    vectorInit();
+    idleInit();
+    traceInit();
+    eventInit();
+    udmaInit();
+    dmaCopyInit();
+    crcInit();
+    poolInit();
+    poolFifoInit(&rxFifo);
+    frameDecoderInit(&rxDecoder, rxFrame, RX_FRAME_MAX, rxFrameReady, 0);
+    uartOpen(&link2, 2, UART2_BAUD, rxDataReady);
+    link2.txHandler = txDone;
+    uartDmaTune(&link2, UART2_RX_FIFO, UART_ARB_MATCH, UART2_TX_FIFO, UART_ARB_MATCH);
+    if (UART2_FLOW) {
+        uartFlowControl(&link2);
+    }
+    if (UART2_PACE_BPS) {
+        uartPace(&link2, UART2_PACE_TIMER, UART2_PACE_BPS, UART2_PACE_BURST);
+    }
+    if (ADC_STREAM_HZ) {
+        adcStreamStart(&adcStream, ADC_STREAM_INPUT, ADC_STREAM_TIMER, ADC_STREAM_HZ, &txEvent);
+    }
 
+    txQueueReset(&link2.tx);
+    txQueueAdd(&link2.tx, prompt, sizeof(prompt) - 1);
+    txQueueAdd(&link2.tx, message, sizeof(message) - 1);
+    txQueueAdd(&link2.tx, lineEnd, sizeof(lineEnd) - 1);
+    txQueueSubmit(&link2.tx);
+    eventTimerStart(&idleTimer, IDLE_REPORT_MS * 1000, IDLE_REPORT_MS * 1000);
+}
 
 void main(void) {
 
-    configUart2();
-    configPortD();
-    baseTableConfig();
-    udmaConfig();
-    UART2_DR_R = '>';
+    appConfig();
 
     while(1)
     {
 
         //========================================================================================================
-        // Infinite loop. Processor waits for evvents to occur. When these events occur, the processor goes into
-        // an interrupt service routine.
+        // Infinite loop. Processor sleeps until events occur (WFI in eventWait). When these events occur, the
+        // processor goes into an interrupt service routine, which posts an event, and then runs the handlers of
+        // all pending events, highest priority first (TX done, received slices, idle report), outside of
+        // interrupt context. Log entries written by the ISRs are printed once the queues are empty. The uDMA
+        // moves the UART data while the processor sleeps.
         //========================================================================================================
 
+        eventRun();
+        logDrain();
+        eventWait();
     }
 }
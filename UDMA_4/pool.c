@@ -0,0 +1,150 @@
+//======================================================================================================
+// Pool of reference counted uDMA buffers
+//======================================================================================================
+
+#include "atomic.h"
+#include "pool.h"
+
+#if defined(__TI_ARM__)
+#pragma DATA_ALIGN(poolMemory, 4)
+static unsigned char poolMemory[POOL_BLOCKS][POOL_BLOCK_SIZE];
+#else
+static unsigned char poolMemory[POOL_BLOCKS][POOL_BLOCK_SIZE] __attribute__((aligned(4)));
+#endif
+
+static PoolBuf poolBufs[POOL_BLOCKS];
+static volatile unsigned int poolFree;      // bit n set: block n is free
+
+//========================================================================================================
+// All blocks free. Must run before the first poolAlloc().
+//========================================================================================================
+
+void poolInit(void) {
+    unsigned int n;
+
+    for (n = 0; n < POOL_BLOCKS; n++) {
+        poolBufs[n].data = poolMemory[n];
+        poolBufs[n].refs = 0;
+    }
+    poolFree = POOL_BLOCKS == 32 ? 0xFFFFFFFF : (1u<<POOL_BLOCKS) - 1;
+}
+
+//========================================================================================================
+// Take a free block, with one reference. Returns 0 if the pool is empty.
+//========================================================================================================
+
+PoolBuf *poolAlloc(void) {
+    unsigned int free, n;
+
+    do {
+        free = poolFree;
+        if (free == 0) {
+            return 0;
+        }
+        for (n = 0; (free & (1u<<n)) == 0; n++);
+    } while (!atomicSwap(&poolFree, free, free & ~(1u<<n)));
+
+    poolBufs[n].refs = 1;
+    return &poolBufs[n];
+}
+
+void poolRef(PoolBuf *buf) {
+    unsigned int refs;
+
+    do {
+        refs = buf->refs;
+    } while (!atomicSwap(&buf->refs, refs, refs + 1));
+}
+
+//========================================================================================================
+// Drop a reference, the last one returns the block to the pool
+//========================================================================================================
+
+void poolRelease(PoolBuf *buf) {
+    unsigned int n = buf - poolBufs;
+    unsigned int refs, free;
+
+    do {
+        refs = buf->refs;
+    } while (!atomicSwap(&buf->refs, refs, refs - 1));
+    if (refs != 1) {
+        return;
+    }
+    do {
+        free = poolFree;
+    } while (!atomicSwap(&poolFree, free, free | (1u<<n)));
+}
+
+//========================================================================================================
+// Free blocks
+//========================================================================================================
+
+unsigned int poolAvailable(void) {
+    unsigned int free = poolFree;
+    unsigned int n = 0;
+
+    while (free) {
+        free &= free - 1;
+        n++;
+    }
+    return n;
+}
+
+//========================================================================================================
+// Slice FIFO
+//========================================================================================================
+
+void poolFifoInit(PoolFifo *f) {
+    f->head = 0;
+    f->tail = 0;
+    f->dropped = 0;
+}
+
+//========================================================================================================
+// Producer: append a slice together with one reference to its block. When the FIFO is full the
+// reference is dropped and the slice counted. Returns 0 on success, -1 if the slice was dropped.
+//========================================================================================================
+
+int poolFifoPut(PoolFifo *f, PoolBuf *buf, unsigned char *data, unsigned int len) {
+    unsigned int head = f->head;
+    volatile PoolSlice *s;
+
+    if (head - f->tail >= POOL_FIFO_LEN) {
+        f->dropped++;
+        poolRelease(buf);
+        return -1;
+    }
+    s = &f->slots[head & (POOL_FIFO_LEN-1)];
+    s->buf = buf;
+    s->data = data;
+    s->len = len;
+    f->head = head + 1;
+    return 0;
+}
+
+//========================================================================================================
+// Consumer: take the oldest slice and its reference. Returns 0 on success, -1 if the FIFO is empty.
+//========================================================================================================
+
+int poolFifoGet(PoolFifo *f, PoolSlice *slice) {
+    unsigned int tail = f->tail;
+    volatile PoolSlice *s;
+
+    if (f->head == tail) {
+        return -1;
+    }
+    s = &f->slots[tail & (POOL_FIFO_LEN-1)];
+    slice->buf = s->buf;
+    slice->data = s->data;
+    slice->len = s->len;
+    f->tail = tail + 1;
+    return 0;
+}
+
+//========================================================================================================
+// Either side: 1 if the FIFO holds no slice. Only a snapshot, the producer may append right after.
+//========================================================================================================
+
+int poolFifoEmpty(const PoolFifo *f) {
+    return f->head == f->tail;
+}
@@ -0,0 +1,60 @@
+//======================================================================================================
+// Pool of reference counted uDMA buffers
+//======================================================================================================
+// POOL_BLOCKS blocks of POOL_BLOCK_SIZE bytes in SRAM, word aligned, so any uDMA channel can read
+// or write them. The receive path of a UART link fills pool blocks and passes them on by handle;
+// the transmit queue sends them straight out of the block (txQueueAddBuf()). No byte is copied
+// between the UART FIFO and the application.
+//
+// A block can be used by several parties at once: the uDMA still filling the rest of it, the
+// application holding the bytes of a frame end, the TX channel echoing them. Every party holds one
+// reference; poolAlloc() returns a block with one reference, poolRef() adds one and poolRelease()
+// drops one. The block returns to the pool when the last reference is dropped.
+//
+// All functions may be called from any context, including nested interrupts: the free map and the
+// reference counts are updated with atomicSwap() (see atomic.h).
+//
+// A PoolFifo passes slices of blocks (block, first byte, length) from one producer to one
+// consumer, e.g. from a receive handler to the main loop, without disabling interrupts:
+// poolFifoPut() only writes head, poolFifoGet() only writes tail. Both indexes run freely and are
+// masked with POOL_FIFO_LEN - 1, so head - tail is the fill level even after a wrap. The reference
+// of a slice travels with it.
+//======================================================================================================
+
+#ifndef POOL_H
+#define POOL_H
+
+#define POOL_BLOCKS 32          // at most 32, the free map is one word
+#define POOL_BLOCK_SIZE 128     // bytes per block, a multiple of 4
+#define POOL_FIFO_LEN 16        // slices per PoolFifo, must be a power of two
+
+typedef struct {
+    unsigned char *data;        // POOL_BLOCK_SIZE bytes
+    volatile unsigned int refs;
+} PoolBuf;
+
+typedef struct {
+    PoolBuf *buf;
+    unsigned char *data;        // first byte, inside buf->data
+    unsigned int len;
+} PoolSlice;
+
+typedef struct {
+    volatile PoolSlice slots[POOL_FIFO_LEN];
+    volatile unsigned int head;     // producer only
+    volatile unsigned int tail;     // consumer only
+    volatile unsigned int dropped;  // slices that did not fit, producer only
+} PoolFifo;
+
+void poolInit(void);
+PoolBuf *poolAlloc(void);
+void poolRef(PoolBuf *buf);
+void poolRelease(PoolBuf *buf);
+unsigned int poolAvailable(void);
+
+void poolFifoInit(PoolFifo *f);
+int poolFifoPut(PoolFifo *f, PoolBuf *buf, unsigned char *data, unsigned int len);
+int poolFifoGet(PoolFifo *f, PoolSlice *slice);
+int poolFifoEmpty(const PoolFifo *f);
+
+#endif // POOL_H
@@ -36,6 +36,7 @@ SECTIONS
     .init_array : > FLASH
 
     .vtable :   > 0x20000000
+    .udma   :   > 0x20000400        /* uDMA control table, 1024 byte aligned */
     .data   :   > SRAM
     .bss    :   > SRAM
     .sysmem :   > SRAM
@@ -0,0 +1,167 @@
+//======================================================================================================
+// Latency instrumentation of the uDMA channels on the DWT cycle counter
+//======================================================================================================
+
+#include "inc/tm4c1294ncpdt.h"
+#include <stdint.h>
+#include "hw.h"
+#include "idle.h"
+#include "trace.h"
+
+//========================================================================================================
+// Debug registers of the Cortex-M4 (not in the device header):
+// DEMCR: TRCENA (bit 24) powers the DWT
+// DWT_CTRL: CYCCNTENA (bit 0) starts the cycle counter
+// DWT_CYCCNT: CPU cycles, wraps after 2^32 (36 s at 120 MHz)
+//========================================================================================================
+
+#define DEMCR 0xE000EDFC
+#define DWT_CTRL 0xE0001000
+#define DWT_CYCCNT 0xE0001004
+
+//========================================================================================================
+// Figures per channel and the submit time of the transfer in flight
+//========================================================================================================
+
+static volatile TraceChannel traceChannels[TRACE_CHANNELS];
+static volatile unsigned long long traceSubmitted[TRACE_CHANNELS];
+static volatile unsigned char traceArmed[TRACE_CHANNELS];
+
+//========================================================================================================
+// Start the cycle counter and clear all figures
+//========================================================================================================
+
+void traceInit(void) {
+    unsigned int ch;
+
+    HWREG(DEMCR) |= (1u<<24);
+    HWREG(DWT_CYCCNT) = 0;
+    HWREG(DWT_CTRL) |= 1;
+
+    for (ch = 0; ch < TRACE_CHANNELS; ch++) {
+        traceArmed[ch] = 0;
+        traceReset(ch);
+    }
+}
+
+unsigned int traceCycles(void) {
+    return HWREG(DWT_CYCCNT);
+}
+
+//========================================================================================================
+// A transfer has been handed to the channel
+//========================================================================================================
+
+void traceSubmit(unsigned int channel) {
+    if (channel < TRACE_CHANNELS) {
+        traceSubmitted[channel] = idleNow();
+        traceArmed[channel] = 1;
+    }
+}
+
+//========================================================================================================
+// Histogram bucket: number of significant bits of value, minus one
+//========================================================================================================
+
+static unsigned int traceBucket(unsigned int value) {
+    unsigned int n = 0;
+
+    while (value > 1) {
+        value >>= 1;
+        n++;
+    }
+    return n;
+}
+
+//========================================================================================================
+// Add one value to a set of figures (also used for those of the event loop, see event.h)
+//========================================================================================================
+
+void traceAdd(volatile TraceStats *s, unsigned int value) {
+    if (s->count == 0 || value < s->min) {
+        s->min = value;
+    }
+    if (value > s->max) {
+        s->max = value;
+    }
+    s->count++;
+    s->sum += value;
+    s->hist[traceBucket(value)]++;
+}
+
+//========================================================================================================
+// The interrupt handler entered at entry (traceCycles()) found the transfer of channel completed.
+// The CPU has been awake since the entry, so going back from the SysTick time of now by the cycles
+// counted since gives the SysTick time of the entry. Spans over 2^32 cycles are clipped.
+//========================================================================================================
+
+void traceComplete(unsigned int channel, unsigned int entry) {
+    volatile TraceChannel *c;
+    unsigned long long at, span;
+
+    if (channel >= TRACE_CHANNELS || !traceArmed[channel]) {
+        return;
+    }
+    c = &traceChannels[channel];
+    at = idleNow() - (traceCycles() - entry);
+    span = at > traceSubmitted[channel] ? at - traceSubmitted[channel] : 0;
+    traceArmed[channel] = 0;
+
+    c->seq++;
+    traceAdd(&c->latency, span > 0xFFFFFFFF ? 0xFFFFFFFF : (unsigned int)span);
+    c->seq++;
+}
+
+//========================================================================================================
+// The interrupt handler entered at entry (traceCycles()) is about to return
+//========================================================================================================
+
+void traceIsr(unsigned int channel, unsigned int entry) {
+    unsigned int cycles = traceCycles() - entry;
+    volatile TraceChannel *c;
+
+    if (channel >= TRACE_CHANNELS) {
+        return;
+    }
+    c = &traceChannels[channel];
+    c->seq++;
+    traceAdd(&c->isr, cycles);
+    c->seq++;
+}
+
+//========================================================================================================
+// Copy the figures of a channel. Called from the main loop; the copy is taken again if an
+// interrupt handler updated them in between.
+//========================================================================================================
+
+void traceGet(unsigned int channel, TraceChannel *out) {
+    volatile TraceChannel *c = &traceChannels[channel % TRACE_CHANNELS];
+    unsigned int seq;
+
+    do {
+        seq = c->seq;
+        *out = *c;
+    } while ((seq & 1) || seq != c->seq);
+}
+
+//========================================================================================================
+// Clear the figures of a channel. Must not run while its interrupt handler can update them.
+//========================================================================================================
+
+void traceReset(unsigned int channel) {
+    volatile TraceChannel *c = &traceChannels[channel % TRACE_CHANNELS];
+    unsigned int n;
+
+    c->seq = 0;
+    c->latency.count = c->isr.count = 0;
+    c->latency.min = c->isr.min = 0;
+    c->latency.max = c->isr.max = 0;
+    c->latency.sum = c->isr.sum = 0;
+    for (n = 0; n < TRACE_BUCKETS; n++) {
+        c->latency.hist[n] = c->isr.hist[n] = 0;
+    }
+}
+
+unsigned int traceMean(const TraceStats *stats) {
+    return stats->count ? (unsigned int)(stats->sum / stats->count) : 0;
+}
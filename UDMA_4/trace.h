@@ -0,0 +1,59 @@
+//======================================================================================================
+// Latency instrumentation of the uDMA channels on the DWT cycle counter
+//======================================================================================================
+// For every uDMA channel two figures are kept, each as count, minimum, maximum, sum and a log2
+// histogram:
+// - latency: system clock cycles from the submit of a transfer to the entry of the interrupt
+//   handler that finds it completed. TX: from txQueueSubmit() to DMATXRIS. RX: from the start of
+//   a receive half (uartOpen(), then the handler that completed the previous half) to DMARXRIS.
+//   A transfer that waits for the UART line includes the character times of its bytes.
+// - isr: CPU cycles from the entry to the exit of the interrupt handler of the link, counted for
+//   the RX channel on DMARX and receive timeouts, for the TX channel on DMATX.
+//
+// Entry and exit of the handler are stamped with DWT_CYCCNT, a single load each. The cycle counter
+// stops while the CPU sleeps in WFI, and a transfer usually spans a sleep, so the latency is taken
+// on the SysTick time of idleNow() (see idle.h) and traceInit() has to follow idleInit().
+//
+// The figures are updated from interrupt context. traceGet() copies those of one channel from the
+// main loop without tearing: every update increments the sequence number of the channel before
+// and after writing.
+//
+// Usage in an interrupt handler:
+// unsigned int entry = traceCycles();
+// ...
+// traceComplete(channel, entry);      // for each transfer found completed
+// ...
+// traceIsr(channel, entry);           // last thing before returning
+//======================================================================================================
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#define TRACE_CHANNELS 32
+#define TRACE_BUCKETS 32    // bucket n counts values of n significant bits (0 and 1 in bucket 0)
+
+typedef struct {
+    unsigned int count;
+    unsigned int min;
+    unsigned int max;
+    unsigned long long sum;
+    unsigned int hist[TRACE_BUCKETS];
+} TraceStats;
+
+typedef struct {
+    unsigned int seq;           // odd while an update is being written
+    TraceStats latency;         // submit to completion interrupt, system clock cycles
+    TraceStats isr;             // interrupt handler entry to exit, CPU cycles
+} TraceChannel;
+
+void traceInit(void);
+unsigned int traceCycles(void);
+void traceSubmit(unsigned int channel);
+void traceComplete(unsigned int channel, unsigned int entry);
+void traceIsr(unsigned int channel, unsigned int entry);
+void traceGet(unsigned int channel, TraceChannel *out);
+void traceReset(unsigned int channel);
+unsigned int traceMean(const TraceStats *stats);
+void traceAdd(volatile TraceStats *s, unsigned int value);
+
+#endif // TRACE_H
@@ -0,0 +1,165 @@
+//======================================================================================================
+// UART transmit queue on a uDMA channel in peripheral scatter-gather mode
+//======================================================================================================
+// Task list entry (one UdmaControl per segment):
+// srcEnd  -> last byte of the segment
+// dstEnd  -> UART data register
+// control -> byte to UART data register, alternate peripheral scatter-gather for all but the
+//            last segment, basic for the last one
+//
+// The primary structure of the TX channel copies one task (4 words) at a time into the alternate
+// structure of the channel, which then sends the segment on the UART TX request.
+//======================================================================================================
+
+#include "inc/tm4c1294ncpdt.h"
+#include "trace.h"
+#include "txQueue.h"
+#include "udma.h"
+
+//========================================================================================================
+// Control word of a segment task, XFERSIZE and ARBSIZE are added per segment
+// DSTINC = no increment
+// DSTSIZE = byte
+// SRCINC = byte
+// SRCSIZE = byte
+// ARBSIZE = q->arb, 4 after txQueueInit(). A burst request of the UART moves that many bytes into
+//           the TX FIFO, so it must not exceed the free space at the TX trigger level.
+// XFERMODE = alternate peripheral scatter-gather, basic for the last segment
+//========================================================================================================
+
+#define TX_SEGMENT_CONTROL UDMA_CONTROL_BASE(UDMA_INC_NONE, UDMA_INC_8, UDMA_SIZE_8, UDMA_ARB_1, \
+                                             UDMA_MODE_PER_SG_ALT)
+#define TX_LAST_CONTROL UDMA_CONTROL_BASE(UDMA_INC_NONE, UDMA_INC_8, UDMA_SIZE_8, UDMA_ARB_1, \
+                                          UDMA_MODE_BASIC)
+
+//========================================================================================================
+// Control word of the primary structure: copy one task (4 words) at a time into the alternate
+// structure, XFERSIZE = 4 * tasks
+// DSTINC = word
+// DSTSIZE = word
+// SRCINC = word
+// SRCSIZE = word
+// ARBSIZE = 4, one task per arbitration as scatter-gather requires
+// XFERMODE = peripheral scatter-gather
+//========================================================================================================
+
+#define TX_LIST_CONTROL UDMA_CONTROL_BASE(UDMA_INC_32, UDMA_INC_32, UDMA_SIZE_32, UDMA_ARB_4, \
+                                          UDMA_MODE_PER_SG)
+
+//========================================================================================================
+// Bind the queue to a uDMA channel and the data register of its UART
+//========================================================================================================
+
+void txQueueInit(TxQueue *q, unsigned int channel, unsigned int dr) {
+    unsigned int n;
+
+    for (n = 0; n < TX_TASKS; n++) {
+        q->bufs[n] = 0;
+    }
+    q->channel = channel;
+    q->dr = dr;
+    q->arb = UDMA_ARB_4;
+    q->count = 0;
+    q->bytes = 0;
+    q->busy = 0;
+}
+
+//========================================================================================================
+// Drop the pool block references of the message
+//========================================================================================================
+
+static void txQueueRelease(TxQueue *q) {
+    unsigned int n;
+
+    for (n = 0; n < q->count; n++) {
+        if (q->bufs[n]) {
+            poolRelease(q->bufs[n]);
+            q->bufs[n] = 0;
+        }
+    }
+}
+
+//========================================================================================================
+// Start a new message. Must not be called while a message is being sent.
+//========================================================================================================
+
+void txQueueReset(TxQueue *q) {
+    txQueueRelease(q);
+    q->count = 0;
+    q->bytes = 0;
+}
+
+//========================================================================================================
+// Append a segment to the message. The data has to stay valid until DMATXRIS.
+// Returns 0 on success, -1 if the list is full or the length is out of range.
+//========================================================================================================
+
+int txQueueAdd(TxQueue *q, const unsigned char *data, unsigned int len) {
+    UdmaControl *task;
+
+    if (q->count == TX_TASKS || len == 0 || len > TX_SEGMENT_MAX) {
+        return -1;
+    }
+    task = &q->tasks[q->count++];
+    task->srcEnd = (unsigned int)&data[len-1];
+    task->dstEnd = q->dr;
+    task->control = TX_SEGMENT_CONTROL | UDMA_CONTROL_ARB(q->arb) | UDMA_XFERSIZE(len);
+    task->spare = 0;
+    q->bufs[q->count-1] = 0;
+    q->bytes += len;
+    return 0;
+}
+
+//========================================================================================================
+// Append len bytes at data, inside pool block buf, without copying them. The queue takes its own
+// reference to the block. Returns 0 on success, -1 as txQueueAdd().
+//========================================================================================================
+
+int txQueueAddBuf(TxQueue *q, PoolBuf *buf, const unsigned char *data, unsigned int len) {
+    if (txQueueAdd(q, data, len) != 0) {
+        return -1;
+    }
+    poolRef(buf);
+    q->bufs[q->count-1] = buf;
+    return 0;
+}
+
+//========================================================================================================
+// Hand the task list to the TX channel. The last task is switched to basic mode so that the channel
+// stops and raises DMATXRIS after it.
+// Returns 0 on success, -1 if the queue is empty or a message is still being sent.
+//========================================================================================================
+
+int txQueueSubmit(TxQueue *q) {
+    unsigned int n = q->count;
+    unsigned int ch = q->channel;
+
+    if (n == 0 || q->busy) {
+        return -1;
+    }
+    q->tasks[n-1].control = TX_LAST_CONTROL
+                          | (q->tasks[n-1].control & (UDMA_CONTROL_ARB_MASK | UDMA_XFERSIZE(1024)));
+
+    controlTable[ch].srcEnd = (unsigned int)&q->tasks[n-1].spare;
+    controlTable[ch].dstEnd = (unsigned int)&controlTable[UDMA_ALT+ch].spare;
+    controlTable[ch].control = TX_LIST_CONTROL | UDMA_XFERSIZE(n*4);
+
+    q->busy = 1;
+    traceSubmit(ch);
+    UDMA_ALTCLR_R = (1u<<ch);
+    UDMA_ENASET_R = (1u<<ch);
+    return 0;
+}
+
+int txQueueBusy(TxQueue *q) {
+    return q->busy;
+}
+
+//========================================================================================================
+// Called by the UART interrupt handler on DMATXRIS. The pool blocks of the message are released.
+//========================================================================================================
+
+void txQueueDone(TxQueue *q) {
+    txQueueRelease(q);
+    q->busy = 0;
+}
@@ -0,0 +1,61 @@
+//======================================================================================================
+// UART transmit queue on a uDMA channel in peripheral scatter-gather mode
+//======================================================================================================
+// A message is built from up to TX_TASKS discontiguous segments (e.g. header, payload, CRC trailer).
+// Every segment becomes one task in a task list in SRAM. txQueueSubmit() points the primary control
+// structure of the TX channel at the task list; from then on the uDMA copies each task into the
+// alternate structure and sends the segment, without the CPU between segments. DMATXRIS is raised
+// once after the last segment.
+//
+// Every UART link owns one TxQueue (see uart.h), bound to its TX channel and data register by
+// txQueueInit().
+//
+// A segment can also be a slice of a pool block (txQueueAddBuf(), see pool.h): the queue holds a
+// reference to the block until the message has been sent, so the caller may drop its own right
+// after adding it. The uDMA reads the bytes straight from the block.
+//
+// Usage:
+// txQueueReset(q);
+// txQueueAdd(q, header, 4);
+// txQueueAdd(q, payload, 32);
+// txQueueAdd(q, trailer, 2);
+// txQueueSubmit(q);
+//======================================================================================================
+
+#ifndef TXQUEUE_H
+#define TXQUEUE_H
+
+#include "pool.h"
+#include "udma.h"
+
+//========================================================================================================
+// Limits: number of segments per message and bytes per segment (XFERSIZE is 10 bits wide)
+//========================================================================================================
+
+#define TX_TASKS 8
+#define TX_SEGMENT_MAX 1024
+
+//========================================================================================================
+// Queue state
+//========================================================================================================
+
+typedef struct {
+    UdmaControl tasks[TX_TASKS];    // task list, read by the uDMA
+    PoolBuf *bufs[TX_TASKS];        // pool block referenced by each task, 0 for plain data
+    unsigned int count;             // tasks of the message being built
+    unsigned int bytes;             // bytes of the message being built or sent
+    unsigned int channel;           // uDMA TX channel
+    unsigned int dr;                // address of the UART data register
+    unsigned int arb;               // ARBSIZE of the segments (UDMA_ARB_*), see uartDmaTune()
+    volatile int busy;
+} TxQueue;
+
+void txQueueInit(TxQueue *q, unsigned int channel, unsigned int dr);
+void txQueueReset(TxQueue *q);
+int txQueueAdd(TxQueue *q, const unsigned char *data, unsigned int len);
+int txQueueAddBuf(TxQueue *q, PoolBuf *buf, const unsigned char *data, unsigned int len);
+int txQueueSubmit(TxQueue *q);
+int txQueueBusy(TxQueue *q);
+void txQueueDone(TxQueue *q);
+
+#endif // TXQUEUE_H
@@ -0,0 +1,958 @@
+//======================================================================================================
+// UART links with uDMA receive and transmit, UART0 to UART7
+//======================================================================================================
+
+#include "inc/tm4c1294ncpdt.h"
+#include <string.h>
+#include "clock.h"
+#include "hw.h"
+#include "log.h"
+#include "pool.h"
+#include "trace.h"
+#include "uart.h"
+#include "udma.h"
+#include "vector.h"
+
+//========================================================================================================
+// Register offsets in the UART, GPIO and timer blocks, next to those of hw.h
+//========================================================================================================
+
+#define UART_DR 0x000
+#define UART_RSR 0x004             // read: RSR, write: ECR
+#define UART_FR 0x018
+#define UART_IBRD 0x024
+#define UART_FBRD 0x028
+#define UART_LCRH 0x02C
+#define UART_CTL 0x030
+#define UART_IFLS 0x034
+#define UART_IM 0x038
+#define UART_MIS 0x040
+#define UART_ICR 0x044
+#define UART_DMACTL 0x048
+
+#define GPIO_LOCK 0x520
+#define GPIO_CR 0x524
+#define GPIO_PCTL 0x52C
+
+#define GPTM_IMR 0x018
+#define GPTM_ICR 0x024
+#define GPTM_DMAEV 0x06C
+
+#define GPTM_INT_DMAA (1u<<5)   // uDMA channel of timer A completed
+#define GPTM_DMAEV_TATO (1u<<0) // timeout of timer A requests its uDMA channel
+
+//========================================================================================================
+// CTL bits
+// RTS: RTS output while RTSEN is clear, RTSEN/CTSEN: hardware flow control
+//========================================================================================================
+
+#define UART_CTL_RTS (1u<<11)
+#define UART_CTL_RTSEN (1u<<14)
+#define UART_CTL_CTSEN (1u<<15)
+
+//========================================================================================================
+// Interrupt bits in IM/MIS/ICR
+// RT = receive timeout, DMARX/DMATX = uDMA channel of RX/TX completed
+// FE, PE, BE, OE = framing, parity, break and overrun error. Shifted down by UART_INT_ERR_SHIFT
+// they line up with the same errors in RSR (bits 0..3) and UART_ERR_*.
+//========================================================================================================
+
+#define UART_INT_RT (1<<6)
+#define UART_INT_FE (1<<7)
+#define UART_INT_PE (1<<8)
+#define UART_INT_BE (1<<9)
+#define UART_INT_OE (1<<10)
+#define UART_INT_ERR (UART_INT_FE | UART_INT_PE | UART_INT_BE | UART_INT_OE)
+#define UART_INT_ERR_SHIFT 7
+#define UART_INT_DMARX (1<<16)
+#define UART_INT_DMATX (1<<17)
+
+//========================================================================================================
+// UART blocks, interrupts and the pin mux of the TM4C1294XL board:
+// UART0: PA0/PA1, UART1: PB0/PB1, UART2: PD4/PD5, UART3: PA4/PA5
+// UART4: PA2/PA3, UART5: PC6/PC7, UART6: PP0/PP1, UART7: PC4/PC5
+//========================================================================================================
+
+const UartHw uartHw[UART_LINKS] = {
+    { 0x4000C000, 0x40058000, INT_UART0,  0, 0, 1, 1 },
+    { 0x4000D000, 0x40059000, INT_UART1,  1, 0, 1, 1 },
+    { 0x4000E000, 0x4005B000, INT_UART2,  3, 4, 5, 1 },
+    { 0x4000F000, 0x40058000, INT_UART3,  0, 4, 5, 1 },
+    { 0x40010000, 0x40058000, INT_UART4,  0, 2, 3, 1 },
+    { 0x40011000, 0x4005A000, INT_UART5,  2, 6, 7, 1 },
+    { 0x40012000, 0x40065000, INT_UART6, 13, 0, 1, 1 },
+    { 0x40013000, 0x4005A000, INT_UART7,  2, 4, 5, 1 },
+};
+
+//========================================================================================================
+// RTS/CTS pins: UART0: PH0/PH1, UART1: PN0/PN1, UART2: PD6/PD7, UART3: PP4/PP5, UART4: PK2/PK3.
+// UART5 to UART7 have no flow control signals.
+//========================================================================================================
+
+const UartFlowHw uartFlowHw[UART_LINKS] = {
+    { 0x4005F000,  7, 0, 1, 1 },
+    { 0x40064000, 12, 0, 1, 1 },
+    { 0x4005B000,  3, 6, 7, 1 },
+    { 0x40065000, 13, 4, 5, 1 },
+    { 0x40061000,  9, 2, 3, 1 },
+    { 0 }, { 0 }, { 0 },
+};
+
+//========================================================================================================
+// Open links, looked up by the interrupt handlers
+//========================================================================================================
+
+static Uart *uartLinks[UART_LINKS];
+
+//========================================================================================================
+// Paced links by timer and the interrupt of timer A of each timer (see uartPace())
+//========================================================================================================
+
+static Uart *uartPaced[UART_PACE_TIMERS];
+
+static const unsigned char uartPaceIrq[UART_PACE_TIMERS] = {
+    INT_TIMER0A, INT_TIMER1A, INT_TIMER2A, INT_TIMER3A,
+};
+
+static const VectorHandler uartPaceHandlers[UART_PACE_TIMERS] = {
+    0, UartPace1Handler, UartPace2Handler, UartPace3Handler,
+};
+
+//========================================================================================================
+// Interrupt handler of each UART, installed by uartOpen()
+//========================================================================================================
+
+static const VectorHandler uartHandlers[UART_LINKS] = {
+    Uart0Handler, Uart1Handler, Uart2Handler, Uart3Handler,
+    Uart4Handler, Uart5Handler, Uart6Handler, Uart7Handler,
+};
+
+//========================================================================================================
+// Pins of a link:
+// Assign clock to the port and wait for it, also in sleep mode (SCGC/DCGC, see idle.h). Set digital
+// enable and alternate select of the RX and TX pins, and their alternate function in PCTL (4 bits
+// per pin).
+//========================================================================================================
+
+static void uartPins(const UartHw *hw) {
+    unsigned int pins = (1u<<hw->rxPin) | (1u<<hw->txPin);
+    unsigned int pctl;
+
+    SYSCTL_RCGCGPIO_R |= (1u<<hw->gpioPort);
+    while ((SYSCTL_PRGPIO_R & (1u<<hw->gpioPort)) == 0);
+    SYSCTL_SCGCGPIO_R |= (1u<<hw->gpioPort);
+    SYSCTL_DCGCGPIO_R |= (1u<<hw->gpioPort);
+    pctl = HWREG(hw->gpioBase + GPIO_PCTL);
+    HWREG(hw->gpioBase + GPIO_DEN) |= pins;
+    HWREG(hw->gpioBase + GPIO_AFSEL) |= pins;
+    pctl &= ~((0x0Fu<<(hw->rxPin*4)) | (0x0Fu<<(hw->txPin*4)));
+    pctl |= ((unsigned int)hw->pctl<<(hw->rxPin*4)) | ((unsigned int)hw->pctl<<(hw->txPin*4));
+    HWREG(hw->gpioBase + GPIO_PCTL) = pctl;
+}
+
+//========================================================================================================
+// uDMA channels of a link, allocated by uartOpen():
+// RX: high priority, so a busy TX channel or another uDMA user cannot delay it into an RX FIFO
+// overrun, and burst requests only, so the bytes of a frame end stay in the RX FIFO until the
+// receive timeout (see uartIsr()).
+// TX: default priority, single and burst requests.
+// Control structures of the RX channel: the primary and the alternate structure each fill one pool
+// block, in ping-pong mode (byte wide, 4 byte arbitration until uartDmaTune()).
+//========================================================================================================
+
+#define UART_RX_POLICY (UDMA_PRIO_HIGH | UDMA_BURST_ONLY)
+#define UART_TX_POLICY 0
+
+//========================================================================================================
+// Arm the primary (half = 0) or alternate (half = 1) RX structure with a fresh pool block. If the
+// pool is empty the structure stays in stop mode and the uDMA halts when it gets there; the next
+// interrupt of the link tries again.
+// Returns 0 on success, -1 if the pool is empty.
+//========================================================================================================
+
+static int uartRxArm(Uart *uart, unsigned int half) {
+    UdmaControl *c = &controlTable[half*UDMA_ALT + uart->rxChannel];
+    PoolBuf *buf = poolAlloc();
+
+    if (buf == 0) {
+        c->control = UDMA_MODE_STOP;
+        uart->stats.rxNoBuffer++;
+        return -1;
+    }
+    uart->rxBuf[half] = buf;
+    c->srcEnd = uart->hw->base + UART_DR;
+    c->dstEnd = (unsigned int)&buf->data[POOL_BLOCK_SIZE-1];
+    c->control = uart->rxControl;
+    return 0;
+}
+
+//========================================================================================================
+// Count receive errors, status in UART_ERR_* bits. An interrupt or an RSR bit stands for at least
+// one character with that error since the last look.
+//========================================================================================================
+
+static void uartRxErrors(Uart *uart, unsigned int status) {
+    if (status & UART_ERR_OVERRUN) {
+        uart->stats.rxOverruns++;
+    }
+    if (status & UART_ERR_BREAK) {
+        uart->stats.rxBreaks++;
+    }
+    if (status & UART_ERR_PARITY) {
+        uart->stats.rxParityErrors++;
+    }
+    if (status & UART_ERR_FRAMING) {
+        uart->stats.rxFramingErrors++;
+    }
+    uart->stats.rxLastError = status;
+    logWrite(LOG_UART_ERROR, uart->number, status);
+}
+
+//========================================================================================================
+// Arm the RX structures that have no block and enable the channel again, which the uDMA disables
+// when it reaches a structure in stop mode. ALTSET tells which structure the uDMA uses next; the
+// channel stays off while that one has no block.
+// An overrun that is pending (see uartIsr()) is counted here, once the channel runs again: as one
+// resync and one log entry for the whole gap. OE is cleared and unmasked again.
+//========================================================================================================
+
+static void uartRxRefill(Uart *uart) {
+    unsigned int base = uart->hw->base;
+    unsigned int rx = 1u<<uart->rxChannel;
+    unsigned int half;
+
+    for (half = 0; half < 2; half++) {
+        if (uart->rxBuf[half] == 0) {
+            uartRxArm(uart, half);
+        }
+    }
+    if (uart->rxBuf[(UDMA_ALTSET_R & rx) ? 1 : 0]) {
+        UDMA_ENASET_R = rx;
+        if (uart->rxOverrun) {
+            uart->rxOverrun = 0;
+            uart->stats.rxResyncs++;
+            uartRxErrors(uart, UART_ERR_OVERRUN);
+            HWREG(base + UART_ICR) = UART_INT_OE;
+            HWREG(base + UART_RSR) = 0;
+            HWREG(base + UART_IM) |= UART_INT_OE;
+        }
+    }
+}
+
+//========================================================================================================
+// Open UART<number> at baud bit/s, 8N1, receiving into pool blocks. udmaInit() and poolInit() must
+// have been called. The link structure has to stay valid while the UART runs.
+// The RX and TX channels and the first two blocks are allocated first, nothing is touched if one
+// of them is missing.
+// LCRH:
+// word length: 8, FEN: All FIFOs enabled, 1 stop bit, parity disabled
+// IFLS:
+// RX and TX trigger level 1/2 (see uartDmaTune())
+// DMACTL:
+// RXDMAE, TXDMAE: uDMA requests for both FIFOs
+// ENASET:
+// Enable the RX channel. The TX channel is enabled by txQueueSubmit() per message.
+// Vector:
+// Uart<number>Handler is installed in the vector table in SRAM (see vector.h)
+// IM:
+// DMATXIM, DMARXIM, RTIM and the receive errors OEIM, BEIM, PEIM, FEIM. TXIM and RXIM stay 0:
+// the FIFOs are serviced by the uDMA and nothing in the ISR clears TXRIS/RXRIS, so they would
+// retrigger the ISR without end.
+// CTL:
+// HSE if the divisor needs it, RXE, TXE, UARTEN
+// Returns 0 on success, -1 on an unknown UART, a baud rate that cannot be reached, no free uDMA
+// channel or an empty pool.
+//========================================================================================================
+
+int uartOpen(Uart *uart, unsigned int number, unsigned int baud, UartRxHandler rxHandler) {
+    const UartHw *hw;
+    unsigned int base;
+    UartDivisor div;
+    int rx, tx;
+
+    if (number >= UART_LINKS || clockUartDivisor(baud, &div) != 0) {
+        return -1;
+    }
+    rx = udmaChannelAlloc(UDMA_UART_RX(number), UART_RX_POLICY);
+    tx = rx < 0 ? -1 : udmaChannelAlloc(UDMA_UART_TX(number), UART_TX_POLICY);
+    if (tx < 0) {
+        if (rx >= 0) {
+            udmaChannelFree(rx);
+        }
+        return -1;
+    }
+    hw = &uartHw[number];
+    base = hw->base;
+
+    uart->hw = hw;
+    uart->number = number;
+    uart->baud = baud;
+    uart->rxChannel = rx;
+    uart->txChannel = tx;
+    uart->rxBuf[0] = 0;
+    uart->rxBuf[1] = 0;
+    uart->rxControl = UDMA_CONTROL_BASE(UDMA_INC_8, UDMA_INC_NONE, UDMA_SIZE_8, UDMA_ARB_4,
+                                        UDMA_MODE_PINGPONG) | UDMA_XFERSIZE(POOL_BLOCK_SIZE);
+    uart->ifls = (UART_FIFO_1_2<<3) | UART_FIFO_1_2;
+    uart->rxArb = UDMA_ARB_4;
+    uart->paceTimer = -1;
+    uart->paceArb = UDMA_ARB_4;
+    uart->rxDelivered = 0;
+    uart->flow = 0;
+    uart->rtsOff = 0;
+    uart->rxHandler = rxHandler;
+    uart->txHandler = 0;
+    uart->txOpHead = 0;
+    uart->txOpTail = 0;
+    uart->txOp = 0;
+    uart->rxOpHead = 0;
+    uart->rxOpTail = 0;
+    uart->stats.rxBytes = 0;
+    uart->stats.rxBlocks = 0;
+    uart->stats.rxFrames = 0;
+    uart->stats.txBytes = 0;
+    uart->stats.txMessages = 0;
+    uart->stats.rxNoBuffer = 0;
+    uart->stats.rtsStops = 0;
+    uart->stats.rxOverruns = 0;
+    uart->stats.rxBreaks = 0;
+    uart->stats.rxParityErrors = 0;
+    uart->stats.rxFramingErrors = 0;
+    uart->stats.rxResyncs = 0;
+    uart->stats.rxLastError = 0;
+    uart->rxOverrun = 0;
+    if (uartRxArm(uart, 0) != 0 || uartRxArm(uart, 1) != 0) {
+        if (uart->rxBuf[0]) {
+            poolRelease(uart->rxBuf[0]);
+        }
+        udmaChannelFree(tx);
+        udmaChannelFree(rx);
+        return -1;
+    }
+    uartLinks[number] = uart;
+
+    SYSCTL_RCGCUART_R |= (1u<<number);
+    while ((SYSCTL_PRUART_R & (1u<<number)) == 0);
+    SYSCTL_SCGCUART_R |= (1u<<number);
+    SYSCTL_DCGCUART_R |= (1u<<number);
+    uartPins(hw);
+
+    HWREG(base + UART_CTL) &= ~(1u<<0);
+    HWREG(base + UART_IBRD) = div.ibrd;
+    HWREG(base + UART_FBRD) = div.fbrd;
+    HWREG(base + UART_LCRH) = 0x00000070;
+    HWREG(base + UART_IFLS) = uart->ifls;
+    HWREG(base + UART_DMACTL) |= 0x03;
+    traceSubmit(rx);
+    UDMA_ENASET_R = (1u<<rx);
+    txQueueInit(&uart->tx, tx, base + UART_DR);
+
+    HWREG(base + UART_RSR) = 0;
+    HWREG(base + UART_IM) |= UART_INT_DMATX | UART_INT_DMARX | UART_INT_RT | UART_INT_ERR;
+    vectorRegister(VECTOR_IRQ(hw->irq), uartHandlers[number]);
+    HWREG(NVIC_EN + 4*(hw->irq/32)) = (1u<<(hw->irq%32));
+    if (div.hse) {
+        HWREG(base + UART_CTL) |= (1u<<5);
+    } else {
+        HWREG(base + UART_CTL) &= ~(1u<<5);
+    }
+    HWREG(base + UART_CTL) |= 0x301;
+    return 0;
+}
+
+//========================================================================================================
+// Bytes at each trigger level, and the largest ARBSIZE whose burst fits into a number of bytes
+//========================================================================================================
+
+static const unsigned char uartFifoBytes[UART_FIFO_7_8 + 1] = { 2, 4, 8, 12, 14 };
+
+static unsigned int uartArbFit(unsigned int bytes) {
+    unsigned int arb = UDMA_ARB_1;
+
+    while ((2u<<arb) <= bytes) {
+        arb++;
+    }
+    return arb;
+}
+
+//========================================================================================================
+// FIFO trigger levels (UART_FIFO_*) and ARBSIZE (UDMA_ARB_* or UART_ARB_MATCH) of an open link.
+// A burst request must find the whole burst: on RX, 2^rxArb bytes must not exceed the RX level, on
+// TX, 2^txArb bytes must fit into the FIFO space left at the TX level. UART_ARB_MATCH takes the
+// largest burst that does, so every burst request empties the RX FIFO below its level or refills
+// the TX FIFO at once.
+// The link interrupt and the requests of the RX channel are masked while the control word of the
+// RX structures that hold a block and IFLS change. The TX queue has to be idle: segments added from
+// now on use txArb, on a paced link once pacing is turned off.
+// Returns 0 on success, -1 on an unknown level or a burst that does not fit.
+//========================================================================================================
+
+int uartDmaTune(Uart *uart, unsigned int rxLevel, unsigned int rxArb, unsigned int txLevel,
+                unsigned int txArb) {
+    unsigned int irq = uart->hw->irq;
+    unsigned int rx = 1u<<uart->rxChannel;
+    unsigned int rxMax, txMax, half;
+    UdmaControl *c;
+
+    if (rxLevel > UART_FIFO_7_8 || txLevel > UART_FIFO_7_8 || txQueueBusy(&uart->tx)) {
+        return -1;
+    }
+    rxMax = uartArbFit(uartFifoBytes[rxLevel]);
+    txMax = uartArbFit(UART_FIFO_DEPTH - uartFifoBytes[txLevel]);
+    rxArb = rxArb == UART_ARB_MATCH ? rxMax : rxArb;
+    txArb = txArb == UART_ARB_MATCH ? txMax : txArb;
+    if (rxArb > rxMax || txArb > txMax) {
+        return -1;
+    }
+
+    HWREG(NVIC_DIS + 4*(irq/32)) = (1u<<(irq%32));
+    UDMA_REQMASKSET_R = rx;
+    uart->rxControl = (uart->rxControl & ~UDMA_CONTROL_ARB_MASK) | UDMA_CONTROL_ARB(rxArb);
+    for (half = 0; half < 2; half++) {
+        c = &controlTable[half*UDMA_ALT + uart->rxChannel];
+        if (uart->rxBuf[half]) {
+            c->control = (c->control & ~UDMA_CONTROL_ARB_MASK) | UDMA_CONTROL_ARB(rxArb);
+        }
+    }
+    uart->ifls = (rxLevel<<3) | txLevel;
+    uart->rxArb = rxArb;
+    if (uart->paceTimer >= 0) {
+        uart->paceArb = txArb;
+    } else {
+        uart->tx.arb = txArb;
+    }
+    HWREG(uart->hw->base + UART_IFLS) = uart->ifls;
+    UDMA_REQMASKCLR_R = rx;
+    HWREG(NVIC_EN + 4*(irq/32)) = (1u<<(irq%32));
+    return 0;
+}
+
+//========================================================================================================
+// Turn on RTS/CTS flow control of an open link:
+// Pins: RTS and CTS to their alternate function (see uartFlowHw[]). PD7 (U2CTS) is locked as NMI
+// pin after reset: LOCK opens the commit register CR, which lets AFSEL/DEN/PCTL of the pin change.
+// CTL:
+// CTSEN => the transmitter only starts a character while CTS is asserted
+// RTSEN stays 0 => RTS follows the RTS bit, driven by uartRtsUpdate(). RTS = 1 asserts it.
+// Returns 0 on success, -1 if the UART has no flow control signals.
+//========================================================================================================
+
+int uartFlowControl(Uart *uart) {
+    const UartFlowHw *fh = &uartFlowHw[uart->number];
+    unsigned int pins = (1u<<fh->rtsPin) | (1u<<fh->ctsPin);
+    unsigned int pctl;
+
+    if (fh->gpioBase == 0) {
+        return -1;
+    }
+    SYSCTL_RCGCGPIO_R |= (1u<<fh->gpioPort);
+    while ((SYSCTL_PRGPIO_R & (1u<<fh->gpioPort)) == 0);
+    SYSCTL_SCGCGPIO_R |= (1u<<fh->gpioPort);
+    SYSCTL_DCGCGPIO_R |= (1u<<fh->gpioPort);
+    HWREG(fh->gpioBase + GPIO_LOCK) = 0x4C4F434B;
+    HWREG(fh->gpioBase + GPIO_CR) |= pins;
+    HWREG(fh->gpioBase + GPIO_LOCK) = 0;
+    pctl = HWREG(fh->gpioBase + GPIO_PCTL);
+    HWREG(fh->gpioBase + GPIO_DEN) |= pins;
+    HWREG(fh->gpioBase + GPIO_AFSEL) |= pins;
+    pctl &= ~((0x0Fu<<(fh->rtsPin*4)) | (0x0Fu<<(fh->ctsPin*4)));
+    pctl |= ((unsigned int)fh->pctl<<(fh->rtsPin*4)) | ((unsigned int)fh->pctl<<(fh->ctsPin*4));
+    HWREG(fh->gpioBase + GPIO_PCTL) = pctl;
+
+    uart->rtsOff = 0;
+    HWREG(uart->hw->base + UART_CTL) = (HWREG(uart->hw->base + UART_CTL) & ~UART_CTL_RTSEN)
+                                     | UART_CTL_RTS | UART_CTL_CTSEN;
+    uart->flow = 1;
+    uartRxKick(uart);
+    return 0;
+}
+
+//========================================================================================================
+// Paced transmit off: timer stopped, its channel given back, the TX queue on the TX channel of the
+// link again
+//========================================================================================================
+
+static void uartPaceStop(Uart *uart) {
+    unsigned int timer = uart->paceTimer;
+    unsigned int base = GPTM_BASE + timer*0x1000;
+    unsigned int irq = uartPaceIrq[timer];
+    unsigned int arb = uart->tx.arb;
+
+    HWREG(base + GPTM_CTL) = 0;
+    HWREG(base + GPTM_DMAEV) = 0;
+    HWREG(base + GPTM_IMR) = 0;
+    HWREG(NVIC_DIS + 4*(irq/32)) = (1u<<(irq%32));
+    udmaChannelFree(uart->tx.channel);
+    uart->tx.channel = uart->txChannel;
+    uart->tx.arb = uart->paceArb;
+    uart->paceArb = arb;
+    uartPaced[timer] = 0;
+    uart->paceTimer = -1;
+    udmaTimerFree(timer);
+}
+
+//========================================================================================================
+// Pace the TX queue of an open link with timer A of GPTM<timer> (1..3): from now on its messages are
+// sent on the uDMA channel of the timer, burst bytes (1, 2, 4, 8 or 16) at every timeout, which
+// makes bytesPerSecond on average. bytesPerSecond must not exceed the line rate (baud / 10), so
+// every burst finds the TX FIFO empty. bytesPerSecond = 0 turns pacing off. The TX queue has to be
+// idle.
+// RCGCTIMER/PRTIMER:
+// clock for the timer, wait until it is ready
+// SCGCTIMER:
+// the timer keeps its clock while the CPU sleeps with auto clock gating (see idle.h)
+// GPTMCTL:
+// TAEN = 0 while the timer is set up, then 1: it runs as long as the link is paced. Timeouts while
+// no message is being sent reach a disabled channel.
+// GPTMCFG:
+// 0x0 => 32 bit timer
+// GPTMTAMR:
+// TAMR = 0x2 => periodic, count down
+// GPTMTAILR:
+// period minus one, in system clock cycles: clockGet() * burst / bytesPerSecond
+// GPTMDMAEV:
+// TATODMAEN = 1 => every timeout is a burst request of the uDMA channel of timer A
+// GPTMIMR:
+// DMAAIM = 1 => interrupt when the channel has sent the last segment of a message, installed in
+// the vector table (see vector.h)
+// Returns 0 on success, -1 on a bad timer, burst or rate, a busy TX queue, a timer that paces
+// another link or is taken otherwise (udmaTimerAlloc()) or no free channel.
+//========================================================================================================
+
+int uartPace(Uart *uart, unsigned int timer, unsigned int bytesPerSecond, unsigned int burst) {
+    unsigned int base = GPTM_BASE + timer*0x1000;
+    unsigned long long period;
+    unsigned int irq;
+    int ch;
+
+    if (txQueueBusy(&uart->tx)) {
+        return -1;
+    }
+    if (bytesPerSecond == 0) {
+        if (uart->paceTimer >= 0) {
+            uartPaceStop(uart);
+        }
+        return 0;
+    }
+    period = (unsigned long long)clockGet() * burst / bytesPerSecond;
+    if (timer == 0 || timer >= UART_PACE_TIMERS || (uartPaced[timer] && uartPaced[timer] != uart) ||
+        burst == 0 || burst > UART_FIFO_DEPTH || (burst & (burst - 1)) != 0 ||
+        bytesPerSecond > uart->baud / 10 || period < 2 || period > 0xFFFFFFFF) {
+        return -1;
+    }
+    if (uart->paceTimer >= 0) {
+        uartPaceStop(uart);
+    }
+    if (udmaTimerAlloc(timer) != 0) {
+        return -1;
+    }
+    ch = udmaChannelAlloc(UDMA_TIMER_A(timer), UDMA_BURST_ONLY);
+    if (ch < 0) {
+        udmaTimerFree(timer);
+        return -1;
+    }
+    irq = uartPaceIrq[timer];
+    uartPaced[timer] = uart;
+    uart->paceTimer = timer;
+    uart->paceArb = uart->tx.arb;
+    uart->tx.channel = ch;
+    uart->tx.arb = uartArbFit(burst);
+
+    SYSCTL_RCGCTIMER_R |= (1u<<timer);
+    while ((SYSCTL_PRTIMER_R & (1u<<timer)) == 0);
+    SYSCTL_SCGCTIMER_R |= (1u<<timer);
+    HWREG(base + GPTM_CTL) = 0;
+    HWREG(base + GPTM_CFG) = 0x0;
+    HWREG(base + GPTM_TAMR) = 0x2;
+    HWREG(base + GPTM_TAILR) = (unsigned int)period - 1;
+    HWREG(base + GPTM_DMAEV) = GPTM_DMAEV_TATO;
+    HWREG(base + GPTM_ICR) = GPTM_INT_DMAA;
+    HWREG(base + GPTM_IMR) = GPTM_INT_DMAA;
+    vectorRegister(VECTOR_IRQ(irq), uartPaceHandlers[timer]);
+    HWREG(NVIC_EN + 4*(irq/32)) = (1u<<(irq%32));
+    HWREG(base + GPTM_CTL) = 0x1;
+    return 0;
+}
+
+//========================================================================================================
+// RTS from the receive buffers: asserted while both RX structures hold a block, deasserted as soon
+// as one of them could not be replaced. Runs in the interrupt handler of the link only.
+//========================================================================================================
+
+static void uartRtsUpdate(Uart *uart) {
+    unsigned int base = uart->hw->base;
+    int stop = uart->rxBuf[0] == 0 || uart->rxBuf[1] == 0;
+
+    if (stop && !uart->rtsOff) {
+        HWREG(base + UART_CTL) &= ~UART_CTL_RTS;
+        uart->rtsOff = 1;
+        uart->stats.rtsStops++;
+    } else if (!stop && uart->rtsOff) {
+        HWREG(base + UART_CTL) |= UART_CTL_RTS;
+        uart->rtsOff = 0;
+    }
+}
+
+//========================================================================================================
+// Blocks have been returned to the pool: if the link is short of a receive block, pend its
+// interrupt, whose handler re-arms the RX structures and asserts RTS again. May be called from any
+// context.
+//========================================================================================================
+
+void uartRxKick(Uart *uart) {
+    unsigned int irq = uart->hw->irq;
+
+    if (uart->rxBuf[0] && uart->rxBuf[1]) {
+        return;
+    }
+    HWREG(NVIC_PEND + 4*(irq/32)) = (1u<<(irq%32));
+}
+
+//========================================================================================================
+// An asynchronous operation is done: state and handler
+//========================================================================================================
+
+static void uartOpFinish(UartOp *op) {
+    op->state = UART_OP_DONE;
+    if (op->handler) {
+        op->handler(op);
+    }
+}
+
+//========================================================================================================
+// Copy received bytes into the queued reads, in order. A read is done when it is full or, with
+// UART_READ_FRAME, when the last bytes of a frame have gone into it.
+// Returns the number of bytes taken.
+//========================================================================================================
+
+static unsigned int uartRxOps(Uart *uart, const unsigned char *data, unsigned int len,
+                              int frameEnd) {
+    unsigned int taken = 0, n;
+    UartOp *op;
+
+    while (taken < len && uart->rxOpTail != uart->rxOpHead) {
+        op = uart->rxOps[uart->rxOpTail & (UART_OPS-1)];
+        n = op->len - op->count;
+        if (n > len - taken) {
+            n = len - taken;
+        }
+        memcpy(op->data + op->count, data + taken, n);
+        op->count += n;
+        taken += n;
+        if (op->count == op->len || (frameEnd && taken == len && (op->flags & UART_READ_FRAME))) {
+            uart->rxOpTail = uart->rxOpTail + 1;
+            uartOpFinish(op);
+        }
+    }
+    return taken;
+}
+
+//========================================================================================================
+// Hand bytes of a block to the queued reads, the rest to the application with a reference of its
+// own
+//========================================================================================================
+
+static void uartDeliver(Uart *uart, PoolBuf *buf, unsigned int offset, unsigned int len,
+                        int frameEnd) {
+    unsigned int taken;
+
+    uart->stats.rxBytes += len;
+    taken = uartRxOps(uart, &buf->data[offset], len, frameEnd);
+    offset += taken;
+    len -= taken;
+    if (len && uart->rxHandler) {
+        poolRef(buf);
+        uart->rxHandler(uart, buf, &buf->data[offset], len, frameEnd);
+    }
+}
+
+//========================================================================================================
+// Hand over the rest of a completed block and drop the reference of the uDMA to it. The uDMA has
+// moved on to the other block, which is traced as the next RX transfer (see trace.h).
+//========================================================================================================
+
+static void uartHalfDone(Uart *uart, unsigned int half, unsigned int entry) {
+    PoolBuf *buf = uart->rxBuf[half];
+
+    traceComplete(uart->rxChannel, entry);
+    traceSubmit(uart->rxChannel);
+    if (uart->rxDelivered < POOL_BLOCK_SIZE) {
+        uartDeliver(uart, buf, uart->rxDelivered, POOL_BLOCK_SIZE - uart->rxDelivered, 0);
+    }
+    uart->rxDelivered = 0;
+    uart->stats.rxBlocks++;
+    uart->rxBuf[half] = 0;
+    poolRelease(buf);
+}
+
+//========================================================================================================
+// Items left in both receive control structures of a link. A completed structure reads back in
+// stop mode and counts 0. Only the uDMA moves this number, down by one for every byte it takes from
+// the RX FIFO, as long as the handler does not re-arm a structure.
+//========================================================================================================
+
+static unsigned int uartRxItemsLeft(const Uart *uart) {
+    unsigned int half, control, left = 0;
+
+    for (half = 0; half < 2; half++) {
+        control = controlTable[half*UDMA_ALT + uart->rxChannel].control;
+        if (UDMA_CONTROL_MODE(control) != UDMA_MODE_STOP) {
+            left += UDMA_CONTROL_ITEMS(control);
+        }
+    }
+    return left;
+}
+
+//========================================================================================================
+// Send the oldest queued write as a message of uart->tx, in segments of up to TX_SEGMENT_MAX bytes.
+// Runs from uartWriteAsync() while the queue is idle and from the interrupt handler at DMATX: a
+// message only completes while the queue is busy, so the two never take a write at the same time.
+//========================================================================================================
+
+static void uartTxNext(Uart *uart) {
+    unsigned int n, len;
+    UartOp *op;
+
+    if (uart->txOpTail == uart->txOpHead || txQueueBusy(&uart->tx)) {
+        return;
+    }
+    op = uart->txOps[uart->txOpTail & (UART_OPS-1)];
+    uart->txOpTail = uart->txOpTail + 1;
+    txQueueReset(&uart->tx);
+    for (n = 0; n < op->len; n += len) {
+        len = op->len - n > TX_SEGMENT_MAX ? TX_SEGMENT_MAX : op->len - n;
+        txQueueAdd(&uart->tx, op->data + n, len);
+    }
+    uart->txOp = op;
+    txQueueSubmit(&uart->tx);
+}
+
+//========================================================================================================
+// Queue a write of len bytes (at most TX_TASKS * TX_SEGMENT_MAX) from data, which has to stay valid
+// until it is done. handler(op) is called from interrupt context when the last byte has been
+// handed to the TX FIFO. Main loop only.
+// Returns 0 if it is queued, -1 if the length is out of range or UART_OPS writes are queued.
+//========================================================================================================
+
+int uartWriteAsync(Uart *uart, UartOp *op, const unsigned char *data, unsigned int len,
+                   UartOpHandler handler, void *context) {
+    unsigned int head = uart->txOpHead;
+
+    if (len == 0 || len > TX_TASKS*TX_SEGMENT_MAX || head - uart->txOpTail >= UART_OPS) {
+        return -1;
+    }
+    op->data = (unsigned char *)data;
+    op->len = len;
+    op->count = 0;
+    op->flags = 0;
+    op->state = UART_OP_PENDING;
+    op->handler = handler;
+    op->context = context;
+    uart->txOps[head & (UART_OPS-1)] = op;
+    uart->txOpHead = head + 1;
+    if (!txQueueBusy(&uart->tx)) {
+        uartTxNext(uart);
+    }
+    return 0;
+}
+
+//========================================================================================================
+// Queue a read of up to len bytes into data. It is done when len bytes have been received or, with
+// UART_READ_FRAME in flags, at the end of a frame (op->count tells how many). handler(op) is called
+// from interrupt context then. Main loop only.
+// Returns 0 if it is queued, -1 if len is 0 or UART_OPS reads are queued.
+//========================================================================================================
+
+int uartReadAsync(Uart *uart, UartOp *op, unsigned char *data, unsigned int len,
+                  unsigned int flags, UartOpHandler handler, void *context) {
+    unsigned int head = uart->rxOpHead;
+
+    if (len == 0 || head - uart->rxOpTail >= UART_OPS) {
+        return -1;
+    }
+    op->data = data;
+    op->len = len;
+    op->count = 0;
+    op->flags = flags;
+    op->state = UART_OP_PENDING;
+    op->handler = handler;
+    op->context = context;
+    uart->rxOps[head & (UART_OPS-1)] = op;
+    uart->rxOpHead = head + 1;
+    return 0;
+}
+
+int uartOpDone(const UartOp *op) {
+    return op->state == UART_OP_DONE;
+}
+
+//========================================================================================================
+// Handler of an operation that posts the event in op->context, e.g. that of an EventTask
+//========================================================================================================
+
+void uartOpPost(UartOp *op) {
+    eventPost((Event *)op->context);
+}
+
+//========================================================================================================
+// A message of uart->tx has been sent, on the TX channel of the link or on the channel of its
+// pacing timer: a write that was sent is completed, the next queued one started, then txHandler is
+// called.
+//========================================================================================================
+
+static void uartTxComplete(Uart *uart, unsigned int entry) {
+    traceComplete(uart->tx.channel, entry);
+    uart->stats.txBytes += uart->tx.bytes;
+    uart->stats.txMessages++;
+    txQueueDone(&uart->tx);
+    if (uart->txOp) {
+        uart->txOp->count = uart->txOp->len;
+        uartOpFinish(uart->txOp);
+        uart->txOp = 0;
+    }
+    uartTxNext(uart);
+    if (uart->txHandler) {
+        uart->txHandler(uart);
+    }
+    traceIsr(uart->tx.channel, entry);
+}
+
+//========================================================================================================
+// Interrupt handler of a link:
+// What causes the interrupt is determined from MIS. The interrupt is cleared using ICR.
+// FE, PE, BE, OE (receive errors) are counted together with the error bits of RSR, which is then
+// cleared through ECR. The uDMA reads DR as bytes, so the error bits of the characters themselves
+// are not seen.
+// OE means that the RX FIFO was full and a character was lost: the uDMA fell behind, or stopped
+// for lack of blocks. The link resynchronizes as after a receive timeout: the bytes up to the gap
+// are handed over as a frame end and the RX channel is re-armed and enabled, so the stream after
+// the gap starts a new frame. The overrun stays pending until the channel runs again, and is then
+// counted as one resync in uartRxRefill(). Until then OEIM is masked: a channel without blocks
+// loses every character the peer sends, and each would raise OE again.
+// RT (receive timeout) is raised when the RX FIFO holds data and the line has been idle for 32 bit
+// periods. The RX channel only answers burst requests, so up to a FIFO trigger level of bytes can
+// be left in the FIFO at the end of a frame. The handler lets the uDMA take them with single
+// requests (USEBURSTCLR) and waits for the FIFO to run empty, which takes a few bus cycles per
+// byte. The wait ends after the uDMA has taken UART_FIFO_DEPTH bytes, even if the peer keeps
+// sending, or when the channel is off because it ran out of blocks: then the bytes stay in the
+// FIFO until the channel is enabled again.
+// DMARX is raised each time one of the two receive control structures is completed. The control
+// word of a completed structure that still has its block reads back as stop mode: the rest of the
+// block is handed to the application while the uDMA keeps filling the other one.
+// After a timeout, the remaining XFERSIZE of the active structure (ALTSET selects it) tells how far
+// the uDMA got into its block; everything up to there is the end of the frame.
+// Both cases, and any interrupt while a structure has no block (e.g. pended by uartRxKick()), end
+// with fresh blocks for the structures that have none and the RX channel enabled, in case both
+// structures were completed before the handler ran or the pool ran empty. With flow control RTS is
+// updated from the blocks the link holds.
+// DMATX is raised when the TX channel has sent the last segment of a message (see
+// uartTxComplete()).
+// Entry and exit are stamped for the latency figures of the channels (see trace.h).
+//========================================================================================================
+
+void uartIsr(Uart *uart) {
+    unsigned int entry = traceCycles();
+    const UartHw *hw = uart->hw;
+    unsigned int ch = uart->rxChannel;
+    unsigned int rx = 1u<<ch;
+    unsigned int mis = HWREG(hw->base + UART_MIS);
+    unsigned int half, received, control, status, left;
+
+    if (mis & UART_INT_ERR) {
+        HWREG(hw->base + UART_ICR) = mis & UART_INT_ERR;
+        status = (mis & UART_INT_ERR) >> UART_INT_ERR_SHIFT;
+        status |= HWREG(hw->base + UART_RSR) & 0x0F;
+        HWREG(hw->base + UART_RSR) = 0;
+        if (status & UART_ERR_OVERRUN) {
+            uart->rxOverrun = 1;
+            mis |= UART_INT_OE;
+            status &= ~UART_ERR_OVERRUN;
+        }
+        if (status) {
+            uartRxErrors(uart, status);
+        }
+    }
+
+    if (mis & (UART_INT_RT | UART_INT_OE)) {
+        HWREG(hw->base + UART_ICR) = UART_INT_RT;
+        UDMA_USEBURSTCLR_R = rx;
+        left = uartRxItemsLeft(uart);
+        while ((HWREG(hw->base + UART_FR) & (1u<<4)) == 0 && (UDMA_ENASET_R & rx) &&
+               left - uartRxItemsLeft(uart) < UART_FIFO_DEPTH);
+        mis |= HWREG(hw->base + UART_MIS);
+    }
+
+    if (mis & UART_INT_DMARX) {
+        HWREG(hw->base + UART_ICR) = UART_INT_DMARX;
+        for (half = 0; half < 2; half++) {
+            if (uart->rxBuf[half] &&
+                UDMA_CONTROL_MODE(controlTable[half*UDMA_ALT + ch].control) == UDMA_MODE_STOP) {
+                uartHalfDone(uart, half, entry);
+            }
+        }
+    }
+
+    if (mis & (UART_INT_RT | UART_INT_OE)) {
+        half = (UDMA_ALTSET_R & rx) ? 1 : 0;
+        control = controlTable[half*UDMA_ALT + ch].control;
+        received = POOL_BLOCK_SIZE - UDMA_CONTROL_ITEMS(control);
+        if (uart->rxBuf[half] && UDMA_CONTROL_MODE(control) != UDMA_MODE_STOP &&
+            received > uart->rxDelivered) {
+            uartDeliver(uart, uart->rxBuf[half], uart->rxDelivered, received - uart->rxDelivered,
+                        1);
+            uart->rxDelivered = received;
+            uart->stats.rxFrames++;
+        }
+        UDMA_USEBURSTSET_R = rx;
+    }
+
+    if ((mis & (UART_INT_DMARX | UART_INT_RT | UART_INT_OE)) || uart->rxBuf[0] == 0 ||
+        uart->rxBuf[1] == 0) {
+        uartRxRefill(uart);
+    }
+    if (uart->rxOverrun) {
+        HWREG(hw->base + UART_IM) &= ~UART_INT_OE;
+    }
+    if (uart->flow) {
+        uartRtsUpdate(uart);
+    }
+
+    if (mis & UART_INT_DMATX) {
+        HWREG(hw->base + UART_ICR) = UART_INT_DMATX;
+        uartTxComplete(uart, entry);
+    }
+    if (mis & (UART_INT_DMARX | UART_INT_RT | UART_INT_ERR)) {
+        traceIsr(ch, entry);
+    }
+}
+
+//========================================================================================================
+// Interrupt handlers, one per UART (installed by uartOpen(), see vector.h)
+//========================================================================================================
+
+void Uart0Handler(void) { uartIsr(uartLinks[0]); }
+void Uart1Handler(void) { uartIsr(uartLinks[1]); }
+void Uart2Handler(void) { uartIsr(uartLinks[2]); }
+void Uart3Handler(void) { uartIsr(uartLinks[3]); }
+void Uart4Handler(void) { uartIsr(uartLinks[4]); }
+void Uart5Handler(void) { uartIsr(uartLinks[5]); }
+void Uart6Handler(void) { uartIsr(uartLinks[6]); }
+void Uart7Handler(void) { uartIsr(uartLinks[7]); }
+
+//========================================================================================================
+// Interrupt handlers of the pacing timers (installed by uartPace()): the paced message has been
+// sent
+//========================================================================================================
+
+static void uartPaceIsr(unsigned int timer) {
+    unsigned int entry = traceCycles();
+
+    HWREG(GPTM_BASE + timer*0x1000 + GPTM_ICR) = GPTM_INT_DMAA;
+    if (uartPaced[timer]) {
+        uartTxComplete(uartPaced[timer], entry);
+    }
+}
+
+void UartPace1Handler(void) { uartPaceIsr(1); }
+void UartPace2Handler(void) { uartPaceIsr(2); }
+void UartPace3Handler(void) { uartPaceIsr(3); }
@@ -0,0 +1,250 @@
+//======================================================================================================
+// UART links with uDMA receive and transmit, UART0 to UART7
+//======================================================================================================
+// Every UART is described by one entry of uartHw[]: register block, NVIC interrupt and the GPIO
+// pins of the default pin mux of the TM4C1294XL board. uartOpen() brings up one link from its
+// entry and allocates its RX and TX channels from the uDMA channel manager (see udma.h), so several
+// links run at the same time on the one uDMA controller, each with its own channels, receive
+// buffer, TX queue and statistics.
+//
+// Receive: the RX channel runs in ping-pong mode over two blocks of the buffer pool (see pool.h).
+// Completed blocks and, after a receive timeout, the end of a frame are handed to the rxHandler of
+// the link from interrupt context (see uartIsr()), by reference: the bytes stay where the uDMA put
+// them. Each completed block is replaced by a fresh one from the pool.
+// Transmit: the TX channel sends scatter-gather messages built on uart->tx (see txQueue.h).
+// Receive errors (overrun, break, parity, framing) are counted in the statistics of the link and
+// logged; after an overrun the receive path resynchronizes (see uartIsr()).
+//
+// FIFO trigger levels and uDMA bursts (uartDmaTune()): the RX FIFO raises its burst request when it
+// holds the RX trigger level, the TX FIFO when it has run down to the TX trigger level. Each burst
+// moves ARBSIZE bytes in one arbitration of the uDMA. A larger burst means fewer arbitrations (less
+// bus time per byte) but a higher RX level leaves less FIFO room for the uDMA to answer late and
+// more bytes for the receive timeout to drain at the end of a frame. uartOpen() starts with half
+// full levels and bursts of 4 bytes.
+//
+// Flow control (uartFlowControl(), UART0 to UART4): CTS holds the transmitter in hardware. RTS is
+// driven by the driver from the receive buffers rather than from the RX FIFO, which the uDMA keeps
+// nearly empty: RTS is asserted while both RX structures hold a pool block, so the uDMA has the
+// rest of the active block and a whole block ahead of it. When a completed block cannot be
+// replaced, RTS is deasserted; the peer stops within a character and the uDMA still has the rest
+// of the active block, so nothing is lost while the application holds on to the pool. Once blocks
+// are back, uartRxKick() lets the link re-arm and assert RTS again.
+//
+// Asynchronous writes and reads (uartWriteAsync(), uartReadAsync()): every operation is described
+// by a UartOp of the caller, its handle, which has to stay in place until the operation is done.
+// Up to UART_OPS writes and UART_OPS reads are queued per link and run one after the other, so
+// the application can queue several and go on (or sleep) meanwhile. A write is sent as one
+// message of uart->tx; at its DMATX the interrupt handler completes it and starts the next queued
+// write right away. Received bytes fill the queued reads in order, copied out of the pool blocks
+// as they are handed over; only bytes that no read is waiting for go to rxHandler. A read is done
+// when its buffer is full or, with UART_READ_FRAME, at the end of a frame.
+// When an operation is done, op->state turns UART_OP_DONE (uartOpDone() polls it) and its handler
+// is called from interrupt context. uartOpPost() as handler posts the event in op->context
+// instead (see event.h), e.g. that of an EventTask waiting for it with TASK_AWAIT().
+// Operations are submitted from the main loop only. Writes may share a link with messages built on
+// uart->tx directly: queued writes go first, the direct user sees txQueueBusy() and tries again in
+// txHandler, which is called after every message.
+//
+// Paced transmit (uartPace()): instead of filling the TX FIFO whenever it runs low, the TX queue
+// of a link can send on the uDMA channel of timer A of a general purpose timer. The timer runs
+// periodically and each timeout is one burst request of that channel: the messages go out in
+// bursts of a fixed size at evenly spaced times, bytesPerSecond on average, which a slow receiver
+// can follow, and the CPU is not involved until the end of a message. A frame rate is a byte rate
+// of frame length times frames per second. The timer interrupt takes the place of DMATX.
+//
+// uartOpen() installs Uart<n>Handler in the vector table in SRAM (see vector.h), uartPace()
+// UartPace<n>Handler on the interrupt of timer n A.
+//======================================================================================================
+
+#ifndef UART_H
+#define UART_H
+
+#include <stdint.h>
+#include "event.h"
+#include "hw.h"
+#include "txQueue.h"
+
+#define UART_LINKS 8
+#define UART_PACE_TIMERS 4          // GPTM 1 to 3 can pace a link, GPTM 0 runs the event loop
+
+//========================================================================================================
+// Hardware description of one UART
+//========================================================================================================
+
+typedef struct {
+    unsigned int base;          // register block
+    unsigned int gpioBase;      // register block of the port (AHB aperture)
+    unsigned char irq;          // interrupt number
+    unsigned char gpioPort;     // bit in RCGCGPIO/PRGPIO
+    unsigned char rxPin;        // pin number of U<n>Rx
+    unsigned char txPin;        // pin number of U<n>Tx
+    unsigned char pctl;         // PCTL function of both pins
+} UartHw;
+
+extern const UartHw uartHw[UART_LINKS];
+
+//========================================================================================================
+// RTS and CTS pins of a UART, gpioBase = 0 if it has none
+//========================================================================================================
+
+typedef struct {
+    unsigned int gpioBase;      // register block of the port (AHB aperture)
+    unsigned char gpioPort;     // bit in RCGCGPIO/PRGPIO
+    unsigned char rtsPin;       // pin number of U<n>RTS
+    unsigned char ctsPin;       // pin number of U<n>CTS
+    unsigned char pctl;         // PCTL function of both pins
+} UartFlowHw;
+
+extern const UartFlowHw uartFlowHw[UART_LINKS];
+
+//========================================================================================================
+// Link
+//========================================================================================================
+
+typedef struct Uart Uart;
+
+//========================================================================================================
+// Called from interrupt context with bytes that the uDMA has written into the pool block buf:
+// - the rest of a block once the uDMA has completed it (frameEnd = 0),
+// - the bytes received so far when the line went idle (frameEnd = 1).
+// The handler is given one reference to buf. The bytes stay valid until it drops the reference
+// with poolRelease(), which may happen later and from any context (e.g. the main loop).
+//========================================================================================================
+
+typedef void (*UartRxHandler)(Uart *uart, PoolBuf *buf, unsigned char *data, unsigned int len,
+                              int frameEnd);
+
+//========================================================================================================
+// Called from interrupt context when a message on uart->tx has been sent. Optional, set after
+// uartOpen().
+//========================================================================================================
+
+typedef void (*UartTxHandler)(Uart *uart);
+
+//========================================================================================================
+// FIFO trigger levels (IFLS) of the 16 byte FIFOs, see uartDmaTune(): RX raises its burst request at
+// that many bytes received, TX when no more than that many bytes are left to send
+//========================================================================================================
+
+#define UART_FIFO_DEPTH 16
+#define UART_FIFO_1_8 0             // 2 bytes
+#define UART_FIFO_1_4 1             // 4 bytes
+#define UART_FIFO_1_2 2             // 8 bytes, after uartOpen()
+#define UART_FIFO_3_4 3             // 12 bytes
+#define UART_FIFO_7_8 4             // 14 bytes
+
+#define UART_ARB_MATCH 0xFF         // largest ARBSIZE a trigger level allows
+
+//========================================================================================================
+// Asynchronous operation, the handle of one uartWriteAsync() or uartReadAsync()
+//========================================================================================================
+
+#define UART_OPS 4                  // queued writes and reads per link, must be a power of two
+
+#define UART_OP_IDLE 0
+#define UART_OP_PENDING 1           // queued or running
+#define UART_OP_DONE 2
+
+#define UART_READ_FRAME 0x1         // a read also ends with the end of a frame
+
+typedef struct UartOp UartOp;
+
+//========================================================================================================
+// Called from interrupt context when an operation is done. Must not submit operations itself: post
+// an event instead (uartOpPost()).
+//========================================================================================================
+
+typedef void (*UartOpHandler)(UartOp *op);
+
+struct UartOp {
+    unsigned char *data;
+    unsigned int len;           // bytes to write, size of the read buffer
+    unsigned int count;         // bytes written or received so far
+    unsigned int flags;         // UART_READ_*
+    volatile int state;         // UART_OP_*
+    UartOpHandler handler;
+    void *context;              // for the handler
+};
+
+//========================================================================================================
+// Receive errors, as in RSR
+//========================================================================================================
+
+#define UART_ERR_FRAMING 0x1        // stop bit was 0
+#define UART_ERR_PARITY 0x2
+#define UART_ERR_BREAK 0x4          // line held low for more than a character
+#define UART_ERR_OVERRUN 0x8        // RX FIFO full, a character was lost
+
+typedef struct {
+    unsigned int rxBytes;       // bytes handed to rxHandler
+    unsigned int rxBlocks;      // blocks completed by the uDMA
+    unsigned int rxFrames;      // frame ends found at a receive timeout
+    unsigned int txBytes;       // bytes of completed messages
+    unsigned int txMessages;    // completed messages
+    unsigned int rxNoBuffer;    // pool empty when a block had to be replaced
+    unsigned int rtsStops;      // times RTS was deasserted
+    unsigned int rxOverruns;    // receive errors: interrupts (or RSR reads) that showed them, an
+                                // overrun once per gap (see uartIsr())
+    unsigned int rxBreaks;
+    unsigned int rxParityErrors;
+    unsigned int rxFramingErrors;
+    unsigned int rxResyncs;     // RX channel resynchronized after an overrun
+    unsigned int rxLastError;   // UART_ERR_* bits of the last error
+} UartStats;
+
+struct Uart {
+    const UartHw *hw;
+    unsigned int number;        // 0..7
+    unsigned int baud;
+    unsigned int rxChannel;     // uDMA channels allocated by uartOpen()
+    unsigned int txChannel;
+    PoolBuf *rxBuf[2];          // block of the primary and alternate structure, 0 if none
+    unsigned int rxControl;     // control word that arms a block
+    unsigned int rxDelivered;   // bytes of the active block already handed over at a timeout
+    unsigned int rxOverrun;     // overrun not yet counted, OEIM masked until the channel runs again
+    unsigned int ifls;          // FIFO trigger levels, as in IFLS
+    unsigned int rxArb;         // ARBSIZE of the RX channel (TX: tx.arb), see uartDmaTune()
+    int paceTimer;              // GPTM that paces the TX queue, -1 if none (see uartPace())
+    unsigned int paceArb;       // ARBSIZE of the TX channel while it is paced
+    int flow;                   // RTS/CTS on, see uartFlowControl()
+    volatile int rtsOff;        // RTS deasserted
+    UartRxHandler rxHandler;
+    UartTxHandler txHandler;
+    TxQueue tx;
+    UartOp *txOps[UART_OPS];    // queued writes: main loop at txOpHead, interrupt at txOpTail
+    volatile unsigned int txOpHead;
+    volatile unsigned int txOpTail;
+    UartOp *txOp;               // write being sent, 0 if the message is not one
+    UartOp *rxOps[UART_OPS];    // queued reads, the same way
+    volatile unsigned int rxOpHead;
+    volatile unsigned int rxOpTail;
+    UartStats stats;
+};
+
+int uartOpen(Uart *uart, unsigned int number, unsigned int baud, UartRxHandler rxHandler);
+int uartDmaTune(Uart *uart, unsigned int rxLevel, unsigned int rxArb, unsigned int txLevel,
+                unsigned int txArb);
+int uartFlowControl(Uart *uart);
+void uartRxKick(Uart *uart);
+int uartPace(Uart *uart, unsigned int timer, unsigned int bytesPerSecond, unsigned int burst);
+int uartWriteAsync(Uart *uart, UartOp *op, const unsigned char *data, unsigned int len,
+                   UartOpHandler handler, void *context);
+int uartReadAsync(Uart *uart, UartOp *op, unsigned char *data, unsigned int len,
+                  unsigned int flags, UartOpHandler handler, void *context);
+int uartOpDone(const UartOp *op);
+void uartOpPost(UartOp *op);
+void uartIsr(Uart *uart);
+
+void Uart0Handler(void);
+void Uart1Handler(void);
+void Uart2Handler(void);
+void Uart3Handler(void);
+void Uart4Handler(void);
+void Uart5Handler(void);
+void Uart6Handler(void);
+void Uart7Handler(void);
+void UartPace1Handler(void);
+void UartPace2Handler(void);
+void UartPace3Handler(void);
+
+#endif // UART_H
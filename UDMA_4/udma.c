@@ -0,0 +1,215 @@
+//======================================================================================================
+// uDMA control table, controller setup and channel allocation
+//======================================================================================================
+// 32 primary and 32 alternate control structures (see udma.h). With the TI compiler the table goes
+// into section .udma, placed on a 1024 byte boundary by tm4c1294ncpdt.cmd. Other compilers (host
+// build) only get the alignment.
+//======================================================================================================
+
+#include "inc/tm4c1294ncpdt.h"
+#include "hw.h"
+#include "log.h"
+#include "udma.h"
+
+#if defined(__TI_ARM__)
+#pragma DATA_SECTION(controlTable, ".udma")
+#pragma DATA_ALIGN(controlTable, 1024)
+UdmaControl controlTable[2*UDMA_CHANNELS];
+#else
+UdmaControl controlTable[2*UDMA_CHANNELS] __attribute__((aligned(1024)));
+#endif
+
+//========================================================================================================
+// Channel assignments (datasheet table "uDMA Channel Assignments"): every channel a peripheral
+// request can be routed to, with its CHMAP encoding. A peripheral with more than one entry gets the
+// first free one.
+//========================================================================================================
+
+typedef struct {
+    unsigned char periph;
+    unsigned char channel;
+    unsigned char encoding;
+} UdmaAssign;
+
+static const UdmaAssign udmaAssign[] = {
+    { UDMA_UART_RX(0),  8, 0 }, { UDMA_UART_TX(0),  9, 0 },
+    { UDMA_UART_RX(1), 22, 0 }, { UDMA_UART_TX(1), 23, 0 },
+    { UDMA_UART_RX(1),  8, 1 }, { UDMA_UART_TX(1),  9, 1 },
+    { UDMA_UART_RX(2),  0, 1 }, { UDMA_UART_TX(2),  1, 1 },
+    { UDMA_UART_RX(2), 12, 1 }, { UDMA_UART_TX(2), 13, 1 },
+    { UDMA_UART_RX(3), 16, 2 }, { UDMA_UART_TX(3), 17, 2 },
+    { UDMA_UART_RX(4), 18, 2 }, { UDMA_UART_TX(4), 19, 2 },
+    { UDMA_UART_RX(5),  6, 2 }, { UDMA_UART_TX(5),  7, 2 },
+    { UDMA_UART_RX(6), 10, 2 }, { UDMA_UART_TX(6), 11, 2 },
+    { UDMA_UART_RX(7), 20, 2 }, { UDMA_UART_TX(7), 21, 2 },
+    { UDMA_SOFTWARE,   30, 0 },
+    { UDMA_TIMER_A(0), 18, 0 }, { UDMA_TIMER_A(1), 20, 0 },
+    { UDMA_TIMER_A(2),  4, 1 }, { UDMA_TIMER_A(2),  6, 1 },
+    { UDMA_TIMER_A(3),  2, 1 },
+    { UDMA_ADC0(0),    14, 0 }, { UDMA_ADC0(1),    15, 0 },
+    { UDMA_ADC0(2),    16, 0 }, { UDMA_ADC0(3),    17, 0 },
+};
+
+#define UDMA_ASSIGNS (sizeof(udmaAssign)/sizeof(udmaAssign[0]))
+
+//========================================================================================================
+// Owner of every channel: peripheral + 1, 0 = free
+//========================================================================================================
+
+static unsigned char udmaOwner[UDMA_CHANNELS];
+
+//========================================================================================================
+// Timers in use (GPTM0..7), 1 = taken
+//========================================================================================================
+
+static unsigned char udmaTimerTaken[GPTM_TIMERS];
+
+unsigned int udmaConflicts;
+
+//========================================================================================================
+// Start the uDMA controller:
+// RCGCDMA:
+// Assigns clock to udma
+// PRDMA:
+// Wait for udma peripheral to acquire clock signal
+// SCGCDMA/DCGCDMA:
+// Keep the uDMA running while the CPU sleeps (see idle.h)
+// CFG:
+// Enable udma controller
+// CTLBASE:
+// Assign base control table (1024 byte aligned)
+// Channels are set up by their drivers through udmaChannelAlloc().
+//========================================================================================================
+
+void udmaInit(void) {
+    SYSCTL_RCGCDMA_R |= 0x01;
+    while(!(SYSCTL_PRDMA_R & 0x01));
+    SYSCTL_SCGCDMA_R |= 0x01;
+    SYSCTL_DCGCDMA_R |= 0x01;
+    UDMA_CFG_R |= 0x01;
+    UDMA_CTLBASE_R = (unsigned int)controlTable;
+}
+
+//========================================================================================================
+// Select the peripheral of a channel: CHMAPn holds a 4 bit encoding per channel, 8 channels per
+// register.
+//========================================================================================================
+
+static void udmaChannelMap(unsigned int channel, unsigned int encoding) {
+    unsigned int shift = (channel % 8) * 4;
+    unsigned int field = (encoding & 0x0F) << shift;
+    unsigned int mask = ~(0x0Fu << shift);
+
+    switch (channel / 8) {
+    case 0: UDMA_CHMAP0_R = (UDMA_CHMAP0_R & mask) | field; break;
+    case 1: UDMA_CHMAP1_R = (UDMA_CHMAP1_R & mask) | field; break;
+    case 2: UDMA_CHMAP2_R = (UDMA_CHMAP2_R & mask) | field; break;
+    case 3: UDMA_CHMAP3_R = (UDMA_CHMAP3_R & mask) | field; break;
+    }
+}
+
+//========================================================================================================
+// Allocate a channel for the request of periph (UDMA_UART_RX(n), ...):
+// ENACLR:
+// Channel off while it is being set up
+// CHMAP:
+// Route the request of periph to the channel
+// ALTCLR:
+// Start on the primary control structure
+// PRIOSET/PRIOCLR, USEBURSTSET/USEBURSTCLR:
+// Policy from flags, see udmaChannelPolicy()
+// REQMASKCLR:
+// Let the peripheral request through
+// Only the bit of the allocated channel is written in every register.
+// Returns the channel, or -1 if the peripheral has no channel left. The conflict is logged with the
+// peripheral and the first of its channels that was taken.
+//========================================================================================================
+
+int udmaChannelAlloc(unsigned int periph, unsigned int flags) {
+    unsigned int i, ch, taken = UDMA_CHANNELS;
+
+    for (i = 0; i < UDMA_ASSIGNS; i++) {
+        if (udmaAssign[i].periph != periph) {
+            continue;
+        }
+        ch = udmaAssign[i].channel;
+        if (udmaOwner[ch] != 0) {
+            if (taken == UDMA_CHANNELS) {
+                taken = ch;
+            }
+            continue;
+        }
+        udmaOwner[ch] = periph + 1;
+        UDMA_ENACLR_R = (1u<<ch);
+        udmaChannelMap(ch, udmaAssign[i].encoding);
+        UDMA_ALTCLR_R = (1u<<ch);
+        udmaChannelPolicy(ch, flags);
+        UDMA_REQMASKCLR_R = (1u<<ch);
+        return ch;
+    }
+    udmaConflicts++;
+    logWrite(LOG_DMA_CONFLICT, periph, taken);
+    return -1;
+}
+
+//========================================================================================================
+// Priority and burst policy of an allocated channel. The controller serves the high priority
+// channels first, then all others, lowest channel number first within each group.
+//========================================================================================================
+
+void udmaChannelPolicy(unsigned int channel, unsigned int flags) {
+    if (flags & UDMA_PRIO_HIGH) {
+        UDMA_PRIOSET_R = (1u<<channel);
+    } else {
+        UDMA_PRIOCLR_R = (1u<<channel);
+    }
+    if (flags & UDMA_BURST_ONLY) {
+        UDMA_USEBURSTSET_R = (1u<<channel);
+    } else {
+        UDMA_USEBURSTCLR_R = (1u<<channel);
+    }
+}
+
+//========================================================================================================
+// Give a channel back: disabled, requests masked, default policy
+//========================================================================================================
+
+void udmaChannelFree(unsigned int channel) {
+    if (channel >= UDMA_CHANNELS) {
+        return;
+    }
+    UDMA_ENACLR_R = (1u<<channel);
+    UDMA_REQMASKSET_R = (1u<<channel);
+    udmaChannelPolicy(channel, 0);
+    udmaOwner[channel] = 0;
+}
+
+//========================================================================================================
+// Peripheral that owns a channel, -1 if the channel is free
+//========================================================================================================
+
+int udmaChannelOwner(unsigned int channel) {
+    if (channel >= UDMA_CHANNELS || udmaOwner[channel] == 0) {
+        return -1;
+    }
+    return udmaOwner[channel] - 1;
+}
+
+//========================================================================================================
+// Claim timer A of GPTM<timer> for one user (event loop, paced link, ADC trigger). Main loop only.
+// Returns 0, or -1 on a bad timer or one that is taken already.
+//========================================================================================================
+
+int udmaTimerAlloc(unsigned int timer) {
+    if (timer >= GPTM_TIMERS || udmaTimerTaken[timer]) {
+        return -1;
+    }
+    udmaTimerTaken[timer] = 1;
+    return 0;
+}
+
+void udmaTimerFree(unsigned int timer) {
+    if (timer < GPTM_TIMERS) {
+        udmaTimerTaken[timer] = 0;
+    }
+}
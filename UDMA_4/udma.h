@@ -0,0 +1,154 @@
+//======================================================================================================
+// uDMA control table layout and control word encoding
+//======================================================================================================
+// The uDMA reads its channel control structures from the table at DMACTLBASE. The table holds 32
+// primary structures followed by 32 alternate structures, 16 bytes each, and must start on a 1024
+// byte boundary: DMACTLBASE ignores the lower 10 address bits. The table is placed in its own
+// section .udma, which tm4c1294ncpdt.cmd puts at 0x20000400 right behind .vtable.
+//
+// Control words are built with UDMA_CONTROL(). All arguments are checked while compiling: an
+// illegal combination (items out of 1..1024, increment smaller than the data size, arbitration
+// size above 1024, unknown mode) does not compile. UDMA_CONTROL() of constant arguments is itself
+// a constant, so re-arming a structure in an ISR is a single store.
+//
+// Channels are owned by their drivers. udmaChannelAlloc() hands out a free channel that can carry
+// the request of a peripheral, selects it in CHMAP and sets its priority and burst policy. Every
+// other channel stays untouched, so a new uDMA user cannot steal or reconfigure a channel of a
+// running stream. When all channels of a peripheral are taken the allocation fails, the conflict
+// is counted in udmaConflicts and written to the log.
+// The general purpose timers that trigger transfers are shared the same way: whoever drives one
+// (the event loop Timer 0, uartPace(), adcStreamStart()) claims it with udmaTimerAlloc() first and
+// gets -1 while another user holds it.
+//======================================================================================================
+
+#ifndef UDMA_H
+#define UDMA_H
+
+//========================================================================================================
+// Control structure
+// End pointers are kept as 32 bit words (not pointers) so the layout is 16 bytes on every build.
+//========================================================================================================
+
+typedef struct {
+    volatile unsigned int srcEnd;   // address of the last source item
+    volatile unsigned int dstEnd;   // address of the last destination item
+    volatile unsigned int control;  // control word, see UDMA_CONTROL()
+    volatile unsigned int spare;    // unused by the uDMA
+} UdmaControl;
+
+#define UDMA_CHANNELS 32
+#define UDMA_ALT UDMA_CHANNELS      // controlTable[UDMA_ALT + ch] is the alternate structure of ch
+
+extern UdmaControl controlTable[2*UDMA_CHANNELS];
+
+//========================================================================================================
+// Address increment (DSTINC, SRCINC) and data size (DSTSIZE = SRCSIZE)
+//========================================================================================================
+
+#define UDMA_INC_8 0
+#define UDMA_INC_16 1
+#define UDMA_INC_32 2
+#define UDMA_INC_NONE 3
+
+#define UDMA_SIZE_8 0
+#define UDMA_SIZE_16 1
+#define UDMA_SIZE_32 2
+
+//========================================================================================================
+// Arbitration size (ARBSIZE): items moved before the uDMA re-arbitrates
+//========================================================================================================
+
+#define UDMA_ARB_1 0
+#define UDMA_ARB_2 1
+#define UDMA_ARB_4 2
+#define UDMA_ARB_8 3
+#define UDMA_ARB_16 4
+#define UDMA_ARB_32 5
+#define UDMA_ARB_64 6
+#define UDMA_ARB_128 7
+#define UDMA_ARB_256 8
+#define UDMA_ARB_512 9
+#define UDMA_ARB_1024 10
+
+//========================================================================================================
+// Transfer mode (XFERMODE)
+//========================================================================================================
+
+#define UDMA_MODE_STOP 0
+#define UDMA_MODE_BASIC 1
+#define UDMA_MODE_AUTO 2
+#define UDMA_MODE_PINGPONG 3
+#define UDMA_MODE_MEM_SG 4
+#define UDMA_MODE_MEM_SG_ALT 5
+#define UDMA_MODE_PER_SG 6
+#define UDMA_MODE_PER_SG_ALT 7
+
+//========================================================================================================
+// Encoders
+// UDMA_CHECK(c) is 0 when c holds and a compile error (negative array size) when it does not, so
+// the arguments of UDMA_CONTROL() and UDMA_CONTROL_BASE() have to be constants.
+// UDMA_CONTROL_BASE() encodes everything but XFERSIZE, for transfers whose length is only known at
+// run time; UDMA_XFERSIZE(n) adds it (n = 1..1024, not checked). UDMA_CONTROL_ARB(arb) is the
+// ARBSIZE field for an arbitration size chosen at run time (not checked either).
+//========================================================================================================
+
+#define UDMA_CHECK(c) (0*sizeof(char[(c) ? 1 : -1]))
+
+#define UDMA_CHECK_INC(inc, size) UDMA_CHECK((inc) <= UDMA_INC_NONE && \
+                                             ((inc) == UDMA_INC_NONE || (inc) >= (size)))
+
+#define UDMA_CONTROL_BASE(dstInc, srcInc, size, arb, mode) \
+    ((unsigned int)(((unsigned int)(dstInc)<<30) | ((unsigned int)(size)<<28) | \
+                    ((unsigned int)(srcInc)<<26) | ((unsigned int)(size)<<24) | \
+                    ((unsigned int)(arb)<<14) | (unsigned int)(mode) | \
+                    UDMA_CHECK_INC(dstInc, size) | UDMA_CHECK_INC(srcInc, size) | \
+                    UDMA_CHECK((size) <= UDMA_SIZE_32) | UDMA_CHECK((arb) <= UDMA_ARB_1024) | \
+                    UDMA_CHECK((mode) <= UDMA_MODE_PER_SG_ALT)))
+
+#define UDMA_XFERSIZE(n) ((((unsigned int)(n))-1)<<4)
+#define UDMA_CONTROL_ARB(arb) (((unsigned int)(arb))<<14)
+#define UDMA_CONTROL_ARB_MASK (0x0Fu<<14)
+
+#define UDMA_CONTROL(dstInc, srcInc, size, arb, items, mode) \
+    (UDMA_CONTROL_BASE(dstInc, srcInc, size, arb, mode) | UDMA_XFERSIZE(items) | \
+     (unsigned int)UDMA_CHECK((items) >= 1 && (items) <= 1024))
+
+//========================================================================================================
+// Decoders for control words read back from the table
+//========================================================================================================
+
+#define UDMA_CONTROL_MODE(c) ((c) & 0x07)
+#define UDMA_CONTROL_ITEMS(c) ((((c)>>4) & 0x3FF) + 1)
+
+//========================================================================================================
+// Peripheral requests served by the allocator (see udmaAssign[] in udma.c)
+//========================================================================================================
+
+#define UDMA_UART_RX(n) ((n)*2)         // UART0..7 receive
+#define UDMA_UART_TX(n) ((n)*2 + 1)     // UART0..7 transmit
+#define UDMA_SOFTWARE 16                // software request only (SWREQ)
+#define UDMA_TIMER_A(n) (17 + (n))      // GPTM0..3 timer A, timeout (burst request, DMAEV)
+#define UDMA_ADC0(ss) (21 + (ss))       // ADC0 sample sequencer 0..3, FIFO holds a result
+#define UDMA_PERIPHS 25
+
+//========================================================================================================
+// Channel policy flags
+// UDMA_PRIO_HIGH: channel is served before all default priority channels (PRIOSET)
+// UDMA_BURST_ONLY: channel ignores single requests (USEBURSTSET), the peripheral has to fill a
+// FIFO up to its trigger level before the channel moves data
+//========================================================================================================
+
+#define UDMA_PRIO_HIGH 0x01
+#define UDMA_BURST_ONLY 0x02
+
+extern unsigned int udmaConflicts;
+
+void udmaInit(void);
+int udmaChannelAlloc(unsigned int periph, unsigned int flags);
+void udmaChannelPolicy(unsigned int channel, unsigned int flags);
+void udmaChannelFree(unsigned int channel);
+int udmaChannelOwner(unsigned int channel);
+int udmaTimerAlloc(unsigned int timer);
+void udmaTimerFree(unsigned int timer);
+
+#endif // UDMA_H
@@ -0,0 +1,61 @@
+//======================================================================================================
+// Vector table in SRAM and interrupt handlers registered at run time
+//======================================================================================================
+// With the TI compiler the table goes into section .vtable, placed at 0x20000000 by
+// tm4c1294ncpdt.cmd. Other compilers (host build) only get the alignment.
+//======================================================================================================
+
+#include "inc/tm4c1294ncpdt.h"
+#include "hw.h"
+#include "vector.h"
+
+#if defined(__TI_ARM__)
+#pragma DATA_SECTION(vectorTable, ".vtable")
+#pragma DATA_ALIGN(vectorTable, 1024)
+VectorHandler vectorTable[VECTOR_COUNT];
+#else
+VectorHandler vectorTable[VECTOR_COUNT] __attribute__((aligned(1024)));
+#endif
+
+//========================================================================================================
+// Move the vectors to SRAM:
+// Copy the table in use (VTOR, the flash table after reset) into vectorTable.
+// NVIC_VTABLE:
+// VTOR = vectorTable. The barrier makes sure the table and VTOR are written before the next
+// exception fetches a vector.
+// Does nothing if VTOR points at vectorTable already. Call before interrupts are enabled, the
+// handlers registered in the old table meanwhile would be lost.
+//========================================================================================================
+
+void vectorInit(void) {
+    const VectorHandler *from = (const VectorHandler *)NVIC_VTABLE_R;
+    unsigned int n;
+
+    if (from == vectorTable) {
+        return;
+    }
+    for (n = 0; n < VECTOR_COUNT; n++) {
+        vectorTable[n] = from[n];
+    }
+    __DSB();
+    NVIC_VTABLE_R = (unsigned int)vectorTable;
+    __DSB();
+}
+
+//========================================================================================================
+// Install handler for vector (VECTOR_SYSTICK, VECTOR_IRQ(n), ...). Install it before the interrupt
+// is enabled. Returns the handler it replaces, 0 on a vector out of range.
+//========================================================================================================
+
+VectorHandler vectorRegister(unsigned int vector, VectorHandler handler) {
+    VectorHandler old;
+
+    if (vector >= VECTOR_COUNT) {
+        return 0;
+    }
+    vectorInit();
+    old = vectorTable[vector];
+    vectorTable[vector] = handler;
+    __DSB();
+    return old;
+}
@@ -0,0 +1,35 @@
+//======================================================================================================
+// Vector table in SRAM and interrupt handlers registered at run time
+//======================================================================================================
+// After reset the core takes its vectors from g_pfnVectors in flash (tm4c1294ncpdt_startup_ccs.c),
+// which holds the fault handlers and IntDefaultHandler for everything else. vectorInit() copies the
+// table VTOR points at into vectorTable, which tm4c1294ncpdt.cmd places in section .vtable at the
+// start of SRAM, and points VTOR there. The core then fetches vectors from SRAM without the flash
+// wait states (5 at 120 MHz, see clock.h).
+//
+// Drivers install their handlers with vectorRegister() when they start an instance: uartOpen()
+// the handler of its UART, dmaCopyInit() the uDMA software interrupt, idleInit() SysTick,
+// adcStreamStart() ADC0 sample sequencer 3. The flash table has no driver handlers, so only
+// instances that are started take a vector.
+// vectorRegister() runs vectorInit() on first use.
+//
+// The table has 16 exception vectors followed by the 114 interrupts of the TM4C1294. Interrupt n
+// of the device header (INT_UART2, ...) is vector VECTOR_IRQ(n). VTOR needs the table aligned to
+// its size rounded up to a power of two: 1024 bytes.
+//======================================================================================================
+
+#ifndef VECTOR_H
+#define VECTOR_H
+
+#define VECTOR_COUNT 130
+#define VECTOR_SYSTICK 15
+#define VECTOR_IRQ(n) ((n) + 16)
+
+typedef void (*VectorHandler)(void);
+
+extern VectorHandler vectorTable[VECTOR_COUNT];
+
+void vectorInit(void);
+VectorHandler vectorRegister(unsigned int vector, VectorHandler handler);
+
+#endif // VECTOR_H
@@ -0,0 +1,427 @@
+//======================================================================================================
+// UART / uDMA benchmarks against the simulated UART / uDMA block
+//======================================================================================================
+// Every run brings the firmware up again on a fresh simulator (clock, vector table, sleep on idle,
+// uDMA, buffer pool, BENCH_UART opened as link2 is in main.c) and streams BENCH_BYTES in both
+// directions: the peer sends frames of the run's size with a gap of BENCH_GAP_BITS bit periods
+// (long enough for the receive timeout), and the link sends messages of the same size back to back.
+// The simulator is deterministic and the data are fixed patterns, so a run gives the same figures
+// every time: a driver change shows as a before/after difference.
+//
+// Transfer modes:
+// - dma: the driver as main.c uses it. The uDMA receives into pool blocks (the receive handler
+//   copies the bytes out and releases the block) and sends every message from the TX queue; the
+//   main loop sleeps in WFI. FIFO levels and ARBSIZE are set with uartDmaTune() (see uart.h).
+// - cpu: the same link with DMACTL and IM cleared; a CPU loop polls FR, writes the next byte into
+//   the TX FIFO while it is not full and reads the RX FIFO while it is not empty.
+//
+// Suites:
+// - fifo: RX trigger level and burst swept with TX at 1/2 and its matching burst, then the other
+//   way round, every combination uartDmaTune() accepts, frames of 61 bytes (default 921600 and
+//   3000000 baud). Picks the best setting per baud rate: most bytes/s without errors, within
+//   BENCH_TIE of it the least bus time.
+// - throughput: baud rate x message size (16, 64, 256, 1024 bytes) x mode, dma with ARBSIZE 1 to 8
+//   on both channels at half full levels (default 115200, 921600 and 3000000 baud).
+//
+// Figures per run, from bring-up until the last byte has been received and handed to the TX FIFO:
+// - bytes/s: bytes of both directions per second of simulated time,
+// - cpu cycles per byte: cycles the CPU was busy (register accesses, interrupt entry and exit, not
+//   sleeping) per byte moved,
+// - interrupts per KB: interrupts and exceptions taken per 1024 bytes moved,
+// - uDMA arbitrations, share of the cycles the uDMA held the bus, cycles in interrupt context,
+// - errors: RX overruns, reads of an empty RX FIFO, writes into a full TX FIFO, bytes that differ
+//   from what was sent and bytes missing at the end of the cycle budget.
+//
+// Usage: udma_bench [-f text|csv|json] [-s fifo|throughput|all] [baud ...]
+// The baud rates given replace the defaults of every suite. make bench prints the text report,
+// make bench-csv and make bench-json write build/bench.csv and build/bench.json.
+//======================================================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "inc/tm4c1294ncpdt.h"
+#include "clock.h"
+#include "idle.h"
+#include "pool.h"
+#include "trace.h"
+#include "uart.h"
+#include "udma.h"
+#include "vector.h"
+
+#define BENCH_UART 2
+#define BENCH_BYTES 1024            // per direction
+#define BENCH_GAP_BITS 48
+#define BENCH_FIFO_SIZE 61
+#define BENCH_TIE 0.001             // bytes/s within 0.1% count as equal
+#define BENCH_BAUDS 8
+
+static const unsigned fifoBauds[] = { 921600, 3000000 };
+static const unsigned throughputBauds[] = { 115200, 921600, 3000000 };
+static const unsigned throughputSizes[] = { 16, 64, 256, 1024 };
+
+//========================================================================================================
+// Register offsets and FR bits of the UART, for the CPU loop
+//========================================================================================================
+
+#define UART_DR 0x000
+#define UART_FR 0x018
+#define UART_IM 0x038
+#define UART_DMACTL 0x048
+#define UART_FR_RXFE (1u<<4)
+#define UART_FR_TXFF (1u<<5)
+
+//========================================================================================================
+// One run: its setting and its figures
+//========================================================================================================
+
+typedef struct {
+    const char *suite;
+    unsigned baud;
+    int cpu;                    // 1: CPU loop, 0: uDMA
+    unsigned size;              // bytes per frame and per message
+    unsigned rxLevel, rxArb, txLevel, txArb;
+    unsigned bytes;             // moved in both directions
+    uint64_t cycles;
+    double bytesPerSecond;
+    uint64_t cpuCycles;
+    double cpuPerByte;
+    uint64_t interrupts;
+    double interruptsPerKb;
+    uint64_t arbitrations;
+    double busShare;
+    uint64_t isrCycles;
+    unsigned errors;
+} BenchResult;
+
+static const unsigned fifoBytes[] = { 2, 4, 8, 12, 14 };
+
+//========================================================================================================
+// Output
+//========================================================================================================
+
+enum { FORMAT_TEXT, FORMAT_CSV, FORMAT_JSON };
+
+static int format = FORMAT_TEXT;
+static unsigned jsonRows;
+
+//========================================================================================================
+// Peer and link state of a run
+//========================================================================================================
+
+static Uart benchLink;
+static unsigned char peerData[BENCH_BYTES];
+static unsigned char rxData[BENCH_BYTES];
+static unsigned char txData[BENCH_BYTES];
+static unsigned rxBytes, peerFrames, txMessages;
+static unsigned runFrames, runSize;
+static uint64_t peerGap;
+
+static void peerFrame(void) {
+    simUartFeed(BENCH_UART, peerData + peerFrames * runSize, runSize);
+    if (++peerFrames < runFrames) {
+        simAt(simStats.cycles + peerGap, peerFrame);
+    }
+}
+
+static void benchRx(Uart *uart, PoolBuf *buf, unsigned char *data, unsigned int len, int frameEnd) {
+    unsigned n = len < BENCH_BYTES - rxBytes ? len : BENCH_BYTES - rxBytes;
+
+    memcpy(rxData + rxBytes, data, n);
+    rxBytes += len;
+    poolRelease(buf);
+    (void)uart;
+    (void)frameEnd;
+}
+
+static void benchTxMessage(Uart *uart) {
+    txQueueReset(&uart->tx);
+    txQueueAdd(&uart->tx, txData + txMessages * runSize, runSize);
+    txQueueSubmit(&uart->tx);
+}
+
+static void benchTx(Uart *uart) {
+    if (++txMessages < runFrames) {
+        benchTxMessage(uart);
+    }
+}
+
+//========================================================================================================
+// CPU loop: both FIFOs served by polling FR, one register access per step
+//========================================================================================================
+
+static void cpuTransfer(unsigned base, uint64_t limit) {
+    unsigned total = runFrames * runSize;
+    unsigned sent = 0;
+    unsigned fr;
+
+    HWREG(base + UART_IM) = 0;
+    HWREG(base + UART_DMACTL) = 0;
+    while ((sent < total || rxBytes < total) && simStats.cycles < limit) {
+        fr = HWREG(base + UART_FR);
+        if (sent < total && !(fr & UART_FR_TXFF)) {
+            HWREG(base + UART_DR) = txData[sent++];
+        }
+        if (!(fr & UART_FR_RXFE)) {
+            rxData[rxBytes++] = (unsigned char)HWREG(base + UART_DR);
+        }
+    }
+    txMessages = sent / runSize;
+}
+
+//========================================================================================================
+// One run of r's setting. The cycle budget is four times the line time. The link gives its
+// channels back at the end so the next run can allocate them again.
+// Returns 0 when the setting was run, -1 if uartDmaTune() refused it.
+//========================================================================================================
+
+static int benchRun(BenchResult *r) {
+    uint64_t bit, limit, start;
+    unsigned n, irq, bad = 0;
+    int tuned;
+
+    simReset();
+    clockInit();
+    vectorInit();
+    idleInit();
+    traceInit();
+    udmaInit();
+    poolInit();
+    if (uartOpen(&benchLink, BENCH_UART, r->baud, benchRx) != 0) {
+        fprintf(stderr, "udma_bench: cannot open uart%u at %u baud\n", BENCH_UART, r->baud);
+        exit(1);
+    }
+    benchLink.txHandler = benchTx;
+    tuned = uartDmaTune(&benchLink, r->rxLevel, r->rxArb, r->txLevel, r->txArb);
+    if (tuned == 0) {
+        r->rxArb = benchLink.rxArb;
+        r->txArb = benchLink.tx.arb;
+        runSize = r->size;
+        runFrames = BENCH_BYTES / r->size;
+        rxBytes = 0;
+        peerFrames = 0;
+        txMessages = 0;
+        bit = simStats.sysclkHz / r->baud;
+        peerGap = (runSize * 10 + BENCH_GAP_BITS) * bit;
+        limit = simStats.cycles + 4 * (runFrames * peerGap + runFrames * runSize * 10 * bit);
+        start = simStats.cycles;
+        memset(&simStats.uart[BENCH_UART], 0, sizeof(simStats.uart[BENCH_UART]));
+        memset(simStats.irqCount, 0, sizeof(simStats.irqCount));
+        simStats.cpuCycles = 0;
+        simStats.dmaArbitrations = 0;
+        simStats.dmaBusCycles = 0;
+        simStats.isrCycles = 0;
+
+        simAt(simStats.cycles, peerFrame);
+        if (r->cpu) {
+            cpuTransfer(benchLink.hw->base, limit);
+        } else {
+            benchTxMessage(&benchLink);
+            while ((rxBytes < runFrames * runSize || txMessages < runFrames) &&
+                   simStats.cycles < limit) {
+                idleSleep();
+            }
+        }
+
+        for (n = 0; n < BENCH_BYTES && n < rxBytes; n++) {
+            bad += rxData[n] != peerData[n];
+        }
+        r->bytes = rxBytes + txMessages * runSize;
+        r->cycles = simStats.cycles - start;
+        r->bytesPerSecond = (double)r->bytes * simStats.sysclkHz / r->cycles;
+        r->cpuCycles = simStats.cpuCycles;
+        r->cpuPerByte = r->bytes ? (double)r->cpuCycles / r->bytes : 0;
+        r->interrupts = 0;
+        for (irq = 0; irq < SIM_NUM_VECTORS; irq++) {
+            r->interrupts += simStats.irqCount[irq];
+        }
+        r->interruptsPerKb = r->bytes ? 1024.0 * r->interrupts / r->bytes : 0;
+        r->arbitrations = simStats.dmaArbitrations;
+        r->busShare = (double)simStats.dmaBusCycles / r->cycles;
+        r->isrCycles = simStats.isrCycles;
+        r->errors = simStats.uart[BENCH_UART].overruns + simStats.uart[BENCH_UART].rxEmptyReads +
+                    simStats.uart[BENCH_UART].txFullWrites + bad +
+                    2 * runFrames * runSize - r->bytes;
+    }
+    udmaChannelFree(benchLink.rxChannel);
+    udmaChannelFree(benchLink.txChannel);
+    return tuned;
+}
+
+//========================================================================================================
+// One row of the report
+//========================================================================================================
+
+static void benchPrint(const BenchResult *r, const char *mark) {
+    switch (format) {
+    case FORMAT_CSV:
+        printf("%s,%u,%s,%u,%u,%u,%u,%u,%u,%llu,%.0f,%llu,%.3f,%llu,%.3f,%llu,%.5f,%llu,%u\n",
+               r->suite, r->baud, r->cpu ? "cpu" : "dma", r->size, fifoBytes[r->rxLevel],
+               1u << r->rxArb, fifoBytes[r->txLevel], 1u << r->txArb, r->bytes,
+               (unsigned long long)r->cycles, r->bytesPerSecond, (unsigned long long)r->cpuCycles,
+               r->cpuPerByte, (unsigned long long)r->interrupts, r->interruptsPerKb,
+               (unsigned long long)r->arbitrations, r->busShare,
+               (unsigned long long)r->isrCycles, r->errors);
+        break;
+    case FORMAT_JSON:
+        printf("%s\n    {\"suite\": \"%s\", \"baud\": %u, \"mode\": \"%s\", \"size\": %u, "
+               "\"rx_level\": %u, \"rx_arb\": %u, \"tx_level\": %u, \"tx_arb\": %u, "
+               "\"bytes\": %u, \"cycles\": %llu, \"bytes_per_s\": %.0f, \"cpu_cycles\": %llu, "
+               "\"cpu_cycles_per_byte\": %.3f, \"interrupts\": %llu, \"interrupts_per_kb\": %.3f, "
+               "\"udma_arbitrations\": %llu, \"bus_share\": %.5f, \"isr_cycles\": %llu, "
+               "\"errors\": %u}", jsonRows++ ? "," : "", r->suite, r->baud,
+               r->cpu ? "cpu" : "dma", r->size, fifoBytes[r->rxLevel], 1u << r->rxArb,
+               fifoBytes[r->txLevel], 1u << r->txArb, r->bytes, (unsigned long long)r->cycles,
+               r->bytesPerSecond, (unsigned long long)r->cpuCycles, r->cpuPerByte,
+               (unsigned long long)r->interrupts, r->interruptsPerKb,
+               (unsigned long long)r->arbitrations, r->busShare,
+               (unsigned long long)r->isrCycles, r->errors);
+        break;
+    default:
+        printf("  %s %4u  rx %2u/%-2u  tx %2u/%-2u  %9.0f bytes/s  %8.2f cpu/byte  %6.1f irq/KB  "
+               "%5llu arb  bus %5.2f%%  isr %6llu  errors %u%s\n", r->cpu ? "cpu" : "dma",
+               r->size, fifoBytes[r->rxLevel], 1u << r->rxArb, fifoBytes[r->txLevel],
+               1u << r->txArb, r->bytesPerSecond, r->cpuPerByte, r->interruptsPerKb,
+               (unsigned long long)r->arbitrations, 100.0 * r->busShare,
+               (unsigned long long)r->isrCycles, r->errors, mark);
+        break;
+    }
+}
+
+static int benchBetter(const BenchResult *r, const BenchResult *best) {
+    if (r->errors) {
+        return 0;
+    }
+    if (best->errors || r->bytesPerSecond > best->bytesPerSecond * (1 + BENCH_TIE)) {
+        return 1;
+    }
+    return r->bytesPerSecond >= best->bytesPerSecond * (1 - BENCH_TIE) &&
+           r->busShare < best->busShare;
+}
+
+//========================================================================================================
+// fifo suite at one baud rate: RX level and burst with TX at 1/2 and its matching burst, then TX
+// level and burst with RX at 1/2 and its matching burst
+//========================================================================================================
+
+static void suiteFifo(unsigned baud) {
+    BenchResult r, best;
+    unsigned side, level, arb;
+
+    memset(&best, 0, sizeof(best));
+    best.errors = 1;
+    if (format == FORMAT_TEXT) {
+        printf("fifo %u baud: mode, size, rx/tx trigger level/burst in bytes\n", baud);
+    }
+    for (side = 0; side < 2; side++) {
+        for (level = UART_FIFO_1_8; level <= UART_FIFO_7_8; level++) {
+            for (arb = UDMA_ARB_1; arb <= UDMA_ARB_16; arb++) {
+                memset(&r, 0, sizeof(r));
+                r.suite = "fifo";
+                r.baud = baud;
+                r.size = BENCH_FIFO_SIZE;
+                r.rxLevel = side ? UART_FIFO_1_2 : level;
+                r.rxArb = side ? UART_ARB_MATCH : arb;
+                r.txLevel = side ? level : UART_FIFO_1_2;
+                r.txArb = side ? arb : UART_ARB_MATCH;
+                if (benchRun(&r) != 0) {
+                    continue;
+                }
+                benchPrint(&r, r.errors ? "  <- errors" : "");
+                if (benchBetter(&r, &best)) {
+                    best = r;
+                }
+            }
+        }
+    }
+    if (format != FORMAT_TEXT) {
+        return;
+    }
+    if (best.errors) {
+        printf("best: none without errors\n");
+    } else {
+        printf("best:\n");
+        benchPrint(&best, "");
+    }
+}
+
+//========================================================================================================
+// throughput suite at one baud rate: every message size with the uDMA at ARBSIZE 1, 2, 4 and 8 and
+// with the CPU loop
+//========================================================================================================
+
+static void suiteThroughput(unsigned baud) {
+    BenchResult r;
+    unsigned size, arb;
+
+    if (format == FORMAT_TEXT) {
+        printf("throughput %u baud: mode, size, rx/tx trigger level/burst in bytes\n", baud);
+    }
+    for (size = 0; size < sizeof(throughputSizes) / sizeof(throughputSizes[0]); size++) {
+        for (arb = UDMA_ARB_1; arb <= UDMA_ARB_8 + 1; arb++) {
+            memset(&r, 0, sizeof(r));
+            r.suite = "throughput";
+            r.baud = baud;
+            r.cpu = arb > UDMA_ARB_8;
+            r.size = throughputSizes[size];
+            r.rxLevel = UART_FIFO_1_2;
+            r.txLevel = UART_FIFO_1_2;
+            r.rxArb = r.cpu ? UART_ARB_MATCH : arb;
+            r.txArb = r.rxArb;
+            if (benchRun(&r) == 0) {
+                benchPrint(&r, r.errors ? "  <- errors" : "");
+            }
+        }
+    }
+}
+
+static void benchSuite(void (*suite)(unsigned), const unsigned *bauds, unsigned count) {
+    unsigned n;
+
+    for (n = 0; n < count; n++) {
+        suite(bauds[n]);
+    }
+}
+
+int main(int argc, char **argv) {
+    unsigned bauds[BENCH_BAUDS], count = 0;
+    const char *suite = "all";
+    int n;
+
+    for (n = 1; n < argc; n++) {
+        if (strcmp(argv[n], "-f") == 0 && n + 1 < argc) {
+            n++;
+            format = strcmp(argv[n], "csv") == 0 ? FORMAT_CSV :
+                     strcmp(argv[n], "json") == 0 ? FORMAT_JSON : FORMAT_TEXT;
+        } else if (strcmp(argv[n], "-s") == 0 && n + 1 < argc) {
+            suite = argv[++n];
+        } else if (count < BENCH_BAUDS) {
+            bauds[count++] = (unsigned)strtoul(argv[n], 0, 0);
+        }
+    }
+    for (n = 0; n < BENCH_BYTES; n++) {
+        peerData[n] = (unsigned char)(n * 13 + (n >> 4));
+        txData[n] = (unsigned char)(n * 5 + 1);
+    }
+
+    if (format == FORMAT_CSV) {
+        printf("suite,baud,mode,size,rx_level,rx_arb,tx_level,tx_arb,bytes,cycles,bytes_per_s,"
+               "cpu_cycles,cpu_cycles_per_byte,interrupts,interrupts_per_kb,udma_arbitrations,"
+               "bus_share,isr_cycles,errors\n");
+    } else if (format == FORMAT_JSON) {
+        printf("{\n  \"sysclk_hz\": %u,\n  \"bytes_per_direction\": %u,\n  \"runs\": [",
+               CLOCK_SYSCLK_HZ, BENCH_BYTES);
+    }
+    if (strcmp(suite, "fifo") == 0 || strcmp(suite, "all") == 0) {
+        benchSuite(suiteFifo, count ? bauds : fifoBauds,
+                   count ? count : sizeof(fifoBauds) / sizeof(fifoBauds[0]));
+    }
+    if (strcmp(suite, "throughput") == 0 || strcmp(suite, "all") == 0) {
+        benchSuite(suiteThroughput, count ? bauds : throughputBauds,
+                   count ? count : sizeof(throughputBauds) / sizeof(throughputBauds[0]));
+    }
+    if (format == FORMAT_JSON) {
+        printf("\n  ]\n}\n");
+    }
+    return 0;
+}
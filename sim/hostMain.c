@@ -0,0 +1,729 @@
+//======================================================================================================
+// Host run of the UDMA_4 firmware against the simulated UART / uDMA block
+//======================================================================================================
+// Runs the bring-up of main() in UDMA_4/main.c (appConfig: clock, vector table in SRAM, sleep on
+// idle, event loop, uDMA and copy service, CRC engine, buffer pool, UART2 link and the
+// prompt/message/line end queued on its TX queue; the drivers install their interrupt handlers
+// themselves) and checks crc32() on the CRC engine and the uDMA copy service. Next to it the host
+// opens EXTRA_LINKS more UART links at a higher rate, so several links stream through the one uDMA
+// controller at the same time. Then it runs the main loop of the firmware (the event handlers:
+// receive FIFO and echo, idle report; log, WFI) until the cycle budget is used up; the simulated
+// clock advances while the CPU sleeps in WFI.
+// A simulated peer sends a short binary frame into every link every PEER_GAP_US microseconds (COBS
+// to UART2, SLIP to the others, see framing.h), so the lines go idle between frames and the
+// receive timeout has to hand them over. UART0 runs with RTS/CTS flow control and is driven into
+// backpressure once (see FLOW_FRAME). UART5 is served by a task of the event loop on asynchronous
+// writes and reads (see ASYNC_ROUNDS), its transmit paced by Timer 3 (see PACE_BPS). UART7 sends
+// a stream of ADC samples taken at the timeouts of Timer 1 (see STREAM_HZ), which is checked on
+// its TX line. At the end the bytes seen on the UART2 TX line (prompt,
+// message and the echo of every frame, decoded again), the statistics of every link, of the UART2
+// receive FIFO and of the frame decoders, the duty cycle measured by the firmware, the latency
+// figures of every uDMA channel in use (see trace.h) and of the event loop (see event.h) and the
+// simulator statistics (bytes per cycle, sleep cycles, interrupt counts, uDMA bus use) are printed.
+// Every scenario has an expected result (see hostExpect()): frames not as sent or lost on the links
+// without overruns, sample gaps of the ADC stream beyond the one pool hold, a wrong CRC or copy, ...
+// Each violation is printed with FAIL and the run exits with 1 if there was any, so "make check"
+// fails. The expected figures are those of the default cycle budget.
+//
+// Usage: udma_sim [cycles]
+//======================================================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "inc/tm4c1294ncpdt.h"
+#include "adc.h"
+#include "crc.h"
+#include "dmaCopy.h"
+#include "event.h"
+#include "framing.h"
+#include "idle.h"
+#include "log.h"
+#include "pool.h"
+#include "trace.h"
+#include "uart.h"
+#include "udma.h"
+
+//========================================================================================================
+// Firmware entry points and data (UDMA_4/main.c)
+//========================================================================================================
+
+void appConfig(void);
+void rxConsume(void);
+
+extern Uart link2;
+extern PoolFifo rxFifo;
+extern FrameDecoder rxDecoder;
+extern unsigned int rxCrcErrors;
+extern unsigned char message[33];
+extern const unsigned char prompt[2];
+extern const unsigned char lineEnd[3];
+
+//========================================================================================================
+// Expected results: a figure outside [min, max] is printed with FAIL and counted, main() returns 1
+// if any was
+//========================================================================================================
+
+static unsigned hostFailures;
+
+static void hostExpect(const char *what, unsigned long long value, unsigned long long min,
+                       unsigned long long max) {
+    if (value < min || value > max) {
+        printf("FAIL %s: %llu, expected %llu to %llu\n", what, value, min, max);
+        hostFailures++;
+    }
+}
+
+//========================================================================================================
+// Additional links opened by the host: UART number and rate
+//========================================================================================================
+
+#define EXTRA_LINKS 3
+#define EXTRA_BAUD 921600
+
+static const unsigned extraNumber[EXTRA_LINKS] = { 0, 5, 7 };
+static Uart extraLink[EXTRA_LINKS];
+
+//========================================================================================================
+// Binary frame sent by the simulated peer once every PEER_GAP_US microseconds, with zeros and the
+// SLIP special bytes in it, followed by its CRC-32 (least significant byte first): COBS encoded to
+// UART2, SLIP encoded to the extra links. The 40 byte COBS frame takes about 3.5 ms on the line at
+// 115200 baud.
+//========================================================================================================
+
+#define PEER_GAP_US 3750
+
+static const unsigned char peerPayload[] = "Peer frame\0with \xC0 and \xDB, zeros\0!";
+#define PEER_FRAME_LEN (sizeof(peerPayload) + 4)
+static unsigned char peerFrameData[PEER_FRAME_LEN];
+static unsigned char peerCobs[COBS_MAX(PEER_FRAME_LEN)];
+static unsigned char peerSlip[SLIP_MAX(PEER_FRAME_LEN)];
+static int peerCobsLen, peerSlipLen;
+
+static void peerEncode(void) {
+    unsigned crc = crc32Soft(peerPayload, sizeof(peerPayload));
+    FrameEncoder e;
+    unsigned n;
+
+    memcpy(peerFrameData, peerPayload, sizeof(peerPayload));
+    for (n = 0; n < 4; n++) {
+        peerFrameData[sizeof(peerPayload) + n] = (unsigned char)(crc >> 8*n);
+    }
+
+    frameEncoderInit(&e, peerCobs, sizeof(peerCobs));
+    cobsEncodeStart(&e);
+    cobsEncodeFeed(&e, peerFrameData, PEER_FRAME_LEN);
+    peerCobsLen = cobsEncodeEnd(&e);
+
+    frameEncoderInit(&e, peerSlip, sizeof(peerSlip));
+    slipEncodeStart(&e);
+    slipEncodeFeed(&e, peerFrameData, PEER_FRAME_LEN);
+    peerSlipLen = slipEncodeEnd(&e);
+}
+
+//========================================================================================================
+// crc32() on the CRC engine against crc32Soft(): the check value of CRC-32 and a long buffer
+// starting off a word boundary, so the bytes before and after the words are used
+//========================================================================================================
+
+#define CRC_CHECK_LEN 1500
+
+static unsigned char crcCheckData[CRC_CHECK_LEN + 1];
+
+static void crcCheck(void) {
+    static const unsigned char check[] = "123456789";
+    unsigned hw, sw;
+    uint64_t start;
+    unsigned n;
+
+    hw = crc32(check, 9);
+    printf("crc32 check value    : 0x%08X (expected 0xCBF43926)\n", hw);
+    hostExpect("crc32 check value", hw, 0xCBF43926, 0xCBF43926);
+    for (n = 0; n < sizeof(crcCheckData); n++) {
+        crcCheckData[n] = (unsigned char)(n * 131 + (n >> 3));
+    }
+    start = simStats.cycles;
+    hw = crc32(crcCheckData + 1, CRC_CHECK_LEN);
+    n = (unsigned)(simStats.cycles - start);
+    sw = crc32Soft(crcCheckData + 1, CRC_CHECK_LEN);
+    printf("crc32 %u bytes     : 0x%08X engine, 0x%08X software, %s, %u cycles\n", CRC_CHECK_LEN,
+           hw, sw, hw == sw ? "ok" : "MISMATCH", n);
+    hostExpect("crc32 engine differs from software", hw != sw, 0, 0);
+}
+
+//========================================================================================================
+// Copy service: a long word copy (two transfers, at most 1024 items each), a halfword fill and a
+// short byte copy that the CPU does, all queued at once; each is compared once it is done
+//========================================================================================================
+
+#define COPY_LEN 5000
+
+static unsigned char copySrc[COPY_LEN], copyDst[COPY_LEN];
+static unsigned copyCalls;
+
+static void copyDone(DmaJob *job) {
+    (void)job;
+    copyCalls++;
+}
+
+static void copyCheck(void) {
+    static DmaJob big, fill, small;     // the uDMA reads fill.fill: not on the host stack
+    uint64_t start;
+    unsigned n, bad = 0;
+
+    for (n = 0; n < COPY_LEN; n++) {
+        copySrc[n] = (unsigned char)(n * 7 + 3);
+    }
+    start = simStats.cycles;
+    dmaMemcpy(&big, copyDst, copySrc, 4800, copyDone, 0);
+    dmaMemset(&fill, copyDst + 4802, 0x5A, 150, copyDone, 0);
+    dmaMemcpy(&small, copyDst + 4961, copySrc + 4961, 31, copyDone, 0);
+    dmaJobWait(&big);
+    dmaJobWait(&fill);
+    n = (unsigned)(simStats.cycles - start);
+    bad += memcmp(copyDst, copySrc, 4800) != 0;
+    for (start = 4802; start < 4952; start++) {
+        bad += copyDst[start] != 0x5A;
+    }
+    bad += copyDst[4801] != 0 || copyDst[4952] != 0;
+    bad += memcmp(copyDst + 4961, copySrc + 4961, 31) != 0;
+    printf("dma copy             : %u jobs done, %u bytes by the uDMA in %u transfers, %u by the "
+           "CPU, %s, %u cycles\n", copyCalls, dmaCopyStats.dmaBytes, dmaCopyStats.transfers,
+           dmaCopyStats.cpuJobs, bad ? "MISMATCH" : "ok", n);
+    hostExpect("dma copy bytes wrong", bad, 0, 0);
+    hostExpect("dma copy jobs done", copyCalls, 3, 3);
+}
+
+//========================================================================================================
+// Flow control on UART0 (the first extra link, RTS/CTS on PH0/PH1): its CTS is held deasserted
+// until the first peer frame, which delays its greeting. With frame FLOW_FRAME the peer sends a
+// burst of FLOW_BURST frames at line rate into UART0 while the main loop takes every free pool
+// block for FLOW_HOLD_US microseconds (a timer of the event loop), and the receive handler of
+// UART0 keeps the blocks it gets meanwhile. UART0 deasserts RTS when it cannot replace a block,
+// the peer waits, and after the blocks are back the burst has to arrive without an overrun.
+// UART7 (no flow control signals) gets the same burst and its blocks are held as well: it overruns,
+// loses the bytes of some frames and has to resynchronize: at most OVERRUN_LOSS frames may be lost
+// or damaged there. UART5 sees a framing and parity error and a break on its line (ERROR_FRAME),
+// which it only counts.
+//========================================================================================================
+
+#define FLOW_UART 0
+#define OVERRUN_UART 7
+#define ERROR_UART 5
+#define ERROR_FRAME 2
+#define FLOW_FRAME 4
+#define FLOW_BURST 40
+#define FLOW_HOLD_US 5000
+#define FLOW_HOLDS 1                    // times the pool is held
+#define OVERRUN_LOSS 10
+
+static unsigned peerFrames;
+static volatile int flowHold;           // 1: take the pool, 2: holding, 3: done
+static PoolBuf *flowBlocks[POOL_BLOCKS];
+static unsigned flowHeld;
+
+//========================================================================================================
+// Peer: starts a frame on every link and schedules the next one
+//========================================================================================================
+
+static void peerFrame(void) {
+    unsigned n;
+
+    if (peerFrames == 1) {
+        simUartCts(FLOW_UART, 1);
+    }
+    if (peerFrames == ERROR_FRAME) {
+        simUartLineError(ERROR_UART, UART_ERR_FRAMING | UART_ERR_PARITY);
+    } else if (peerFrames == ERROR_FRAME + 1) {
+        simUartLineError(ERROR_UART, UART_ERR_BREAK);
+    }
+    if (peerFrames++ == FLOW_FRAME) {
+        for (n = 1; n < FLOW_BURST; n++) {
+            simUartFeed(FLOW_UART, peerSlip, peerSlipLen);
+            simUartFeed(OVERRUN_UART, peerSlip, peerSlipLen);
+        }
+        flowHold = 1;
+    }
+    simUartFeed(2, peerCobs, peerCobsLen);
+    for (n = 0; n < EXTRA_LINKS; n++) {
+        simUartFeed(extraNumber[n], peerSlip, peerSlipLen);
+    }
+    simAt(simStats.cycles + (uint64_t)PEER_GAP_US * simStats.sysclkHz / 1000000, peerFrame);
+}
+
+//========================================================================================================
+// Receive side of the extra links: the bytes are SLIP decoded right in the receive handler and the
+// block goes straight back to the pool. Every frame is compared with what the peer sent.
+//========================================================================================================
+
+static FrameDecoder extraDecoder[EXTRA_LINKS];
+static unsigned char extraFrame[EXTRA_LINKS][64];
+static unsigned extraBad[EXTRA_LINKS];
+
+static void extraFrameReady(void *context, unsigned char *frame, unsigned int len) {
+    unsigned n = (unsigned)(uintptr_t)context;
+
+    if (len != PEER_FRAME_LEN || memcmp(frame, peerFrameData, len) != 0) {
+        extraBad[n]++;
+    }
+}
+
+static void extraRx(Uart *uart, PoolBuf *buf, unsigned char *data, unsigned int len, int frameEnd) {
+    unsigned n;
+
+    for (n = 0; n < EXTRA_LINKS && &extraLink[n] != uart; n++);
+    slipDecode(&extraDecoder[n], data, len);
+    if (flowHold == 2 && (uart->number == FLOW_UART || uart->number == OVERRUN_UART) &&
+        flowHeld < POOL_BLOCKS) {
+        flowBlocks[flowHeld++] = buf;
+        return;
+    }
+    poolRelease(buf);
+    (void)frameEnd;
+}
+
+//========================================================================================================
+// UART2 echoes every COBS frame it receives; the echo on its TX line is decoded again and compared
+//========================================================================================================
+
+static unsigned echoBad;
+
+static void echoFrameReady(void *context, unsigned char *frame, unsigned int len) {
+    (void)context;
+    if (len != PEER_FRAME_LEN || memcmp(frame, peerFrameData, len) != 0) {
+        echoBad++;
+    }
+}
+
+//========================================================================================================
+// Asynchronous operations on UART5: a task queues a read of a frame before the first one arrives
+// and two writes behind the message of main(), then reads ASYNC_ROUNDS frames and writes every one
+// back, one at a time. Every operation posts the task when it is done. The frames read go to the
+// SLIP decoder of the link as well, so its figures stay complete.
+// The link sends at PACE_BPS, a quarter of its line rate, in bursts of PACE_BURST bytes on the
+// uDMA channel of Timer 3 (see uartPace()); the time from each echo write to its completion gives
+// the rate reached.
+//========================================================================================================
+
+#define ASYNC_LINK 1            // index in extraLink, UART5
+#define ASYNC_ROUNDS 8
+#define PACE_TIMER 3
+#define PACE_BPS (EXTRA_BAUD / 40)
+#define PACE_BURST 8
+
+static const unsigned char asyncHello[] = "Async hello\r\n";
+static UartOp asyncRead, asyncWrite[2];
+static unsigned char asyncData[64], asyncEcho[64];
+static unsigned asyncRound, asyncLen, asyncReads, asyncBad, asyncWrites;
+static uint64_t asyncStart, asyncCycles, asyncBytes;
+
+static void asyncWork(Event *event) {
+    EventTask *task = (EventTask *)event;
+    Uart *uart = &extraLink[ASYNC_LINK];
+
+    TASK_BEGIN(task);
+    uartReadAsync(uart, &asyncRead, asyncData, sizeof(asyncData), UART_READ_FRAME, uartOpPost,
+                  event);
+    uartWriteAsync(uart, &asyncWrite[0], asyncHello, sizeof(asyncHello) - 1, uartOpPost, event);
+    uartWriteAsync(uart, &asyncWrite[1], message, sizeof(message) - 1, uartOpPost, event);
+    TASK_AWAIT(task, uartOpDone(&asyncWrite[0]) && uartOpDone(&asyncWrite[1]));
+    asyncWrites += 2;
+
+    for (asyncRound = 0; asyncRound < ASYNC_ROUNDS; asyncRound++) {
+        TASK_AWAIT(task, uartOpDone(&asyncRead));
+        asyncReads++;
+        if (asyncRead.count != (unsigned)peerSlipLen ||
+            memcmp(asyncData, peerSlip, asyncRead.count) != 0) {
+            asyncBad++;
+        }
+        slipDecode(&extraDecoder[ASYNC_LINK], asyncData, asyncRead.count);
+        asyncLen = asyncRead.count;
+        memcpy(asyncEcho, asyncData, asyncLen);
+        if (asyncRound + 1 < ASYNC_ROUNDS) {
+            uartReadAsync(uart, &asyncRead, asyncData, sizeof(asyncData), UART_READ_FRAME,
+                          uartOpPost, event);
+        }
+        asyncStart = simStats.cycles;
+        uartWriteAsync(uart, &asyncWrite[0], asyncEcho, asyncLen, uartOpPost, event);
+        TASK_AWAIT(task, uartOpDone(&asyncWrite[0]));
+        asyncCycles += simStats.cycles - asyncStart;
+        asyncBytes += asyncLen;
+        asyncWrites++;
+    }
+    TASK_END(task);
+}
+
+static EventTask asyncTask = EVENT_TASK_INIT(asyncWork, EVENT_PRIO_NORMAL, 0);
+
+//========================================================================================================
+// UART5 TX line: message of main(), asyncHello, message, then the echo of every frame read
+//========================================================================================================
+
+static void asyncCheck(void) {
+    unsigned char line[1024];
+    unsigned n, at, echoes = 0;
+    uint64_t rate;
+
+    n = simUartCapture(5, line, sizeof(line));
+    at = 2*(sizeof(message) - 1) + sizeof(asyncHello) - 1;
+    if (n >= at && memcmp(line + sizeof(message) - 1, asyncHello, sizeof(asyncHello) - 1) == 0) {
+        for (; at + peerSlipLen <= n && memcmp(line + at, peerSlip, peerSlipLen) == 0;
+             at += peerSlipLen) {
+            echoes++;
+        }
+    }
+    printf("uart5 async          : %u reads, %u not as sent, %u writes done, %u echoes on the line"
+           "%s\n", asyncReads, asyncBad, asyncWrites, echoes, at == n ? "" : ", extra bytes");
+    rate = asyncCycles ? asyncBytes * simStats.sysclkHz / asyncCycles : 0;
+    printf("uart5 paced          : echoes at %llu bytes/s, %u set, %u line rate\n",
+           (unsigned long long)rate, PACE_BPS, EXTRA_BAUD / 10);
+
+    hostExpect("uart5 async reads", asyncReads, ASYNC_ROUNDS, ASYNC_ROUNDS);
+    hostExpect("uart5 async reads not as sent", asyncBad, 0, 0);
+    hostExpect("uart5 async writes done", asyncWrites, ASYNC_ROUNDS + 2, ASYNC_ROUNDS + 2);
+    hostExpect("uart5 async echoes on the line", echoes, ASYNC_ROUNDS, ASYNC_ROUNDS);
+    hostExpect("uart5 async extra bytes", n - at, 0, 0);
+    hostExpect("uart5 paced bytes/s", rate, PACE_BPS * 9 / 10, PACE_BPS);
+}
+
+//========================================================================================================
+// ADC stream on UART7 (see adc.h): AIN<STREAM_INPUT> at STREAM_HZ samples per second, triggered by
+// Timer 1, about a third of the line rate. Every completed block and every message sent post
+// streamEvent, which hands the blocks to the TX queue. The simulated input is a ramp, sample n of
+// AIN<a> is (n + a) mod 4096, so every sample lost on the way shows on the TX line, as do the
+// blocks lost while the flow control test holds the pool.
+//========================================================================================================
+
+#define STREAM_LINK 2           // index in extraLink, UART7
+#define STREAM_INPUT 0
+#define STREAM_TIMER 1
+#define STREAM_HZ 16000
+
+static AdcStream hostStream;
+
+static unsigned streamRamp(unsigned ain, uint64_t n) {
+    return (unsigned)(n + ain) & 0xFFF;
+}
+
+static void streamWork(Event *event) {
+    adcStreamSend(&hostStream, &extraLink[STREAM_LINK]);
+    (void)event;
+}
+
+static Event streamEvent = EVENT_INIT(streamWork, EVENT_PRIO_HIGH, 0);
+
+static void streamTxDone(Uart *uart) {
+    (void)uart;
+    eventPost(&streamEvent);
+}
+
+//========================================================================================================
+// UART7 TX line: message of main(), then the sample blocks. Blocks missing from the sequence and
+// samples that do not follow the ramp are counted. The one hold of the pool by the flow control
+// test may cost samples (a single gap in the ramp), no block may go missing.
+//========================================================================================================
+
+static void streamCheck(void) {
+    static unsigned char line[16384];
+    const AdcStats *s = &hostStream.stats;
+    unsigned n, at, k, seq, sample, expect = 0, next = STREAM_INPUT;
+    unsigned blocks = 0, missing = 0, gaps = 0;
+    const unsigned char *b;
+
+    n = simUartCapture(7, line, sizeof(line));
+    for (at = sizeof(message) - 1; at + ADC_BLOCK_LEN <= n; at += ADC_BLOCK_LEN) {
+        b = line + at;
+        if (b[0] != ADC_MAGIC0 || b[1] != ADC_MAGIC1) {
+            break;
+        }
+        seq = b[2] | (b[3] << 8);
+        missing += (seq - expect) & 0xFFFF;
+        expect = (seq + 1) & 0xFFFF;
+        for (k = 0; k < ADC_BLOCK_SAMPLES; k++) {
+            sample = b[ADC_HEADER_LEN + 2*k] | (b[ADC_HEADER_LEN + 2*k + 1] << 8);
+            gaps += sample != next;
+            next = (sample + 1) & 0xFFF;
+        }
+        blocks++;
+    }
+    printf("uart7 adc stream     : %u blocks on the line (%u samples), %u missing, %u sample gaps"
+           "%s\n", blocks, blocks * ADC_BLOCK_SAMPLES, missing, gaps,
+           at + ADC_BLOCK_LEN <= n ? ", bad bytes" : "");
+    printf("adc stream firmware  : %u blocks, %u sent, %u dropped, pool empty %u, overflows %u\n",
+           s->blocks, s->sent, hostStream.fifo.dropped, s->noBuffer, s->overflows);
+
+    k = (unsigned)(simStats.adcConversions / ADC_BLOCK_SAMPLES);
+    hostExpect("adc stream blocks", s->blocks, k - 1, k);
+    hostExpect("adc stream blocks on the line", blocks, s->sent - 1, s->sent);
+    hostExpect("adc stream blocks missing", missing, 0, 0);
+    hostExpect("adc stream sample gaps", gaps, 0, 1);
+    hostExpect("adc stream bad bytes", at + ADC_BLOCK_LEN <= n, 0, 0);
+    hostExpect("adc stream blocks dropped", hostStream.fifo.dropped, 0, 0);
+}
+
+//========================================================================================================
+// Main loop side of the flow control test: take the free blocks, give them back when flowTimer
+// expires FLOW_HOLD_US later and let every link re-arm
+//========================================================================================================
+
+static void flowRelease(Event *event) {
+    unsigned n;
+
+    flowHold = 3;
+    while (flowHeld) {
+        poolRelease(flowBlocks[--flowHeld]);
+    }
+    uartRxKick(&link2);
+    for (n = 0; n < EXTRA_LINKS; n++) {
+        uartRxKick(&extraLink[n]);
+    }
+    adcStreamKick(&hostStream);
+    (void)event;
+}
+
+static EventTimer flowTimer = { EVENT_INIT(flowRelease, EVENT_PRIO_NORMAL, 0) };
+
+static void flowStep(void) {
+    PoolBuf *buf;
+
+    if (flowHold == 1) {
+        while (flowHeld < POOL_BLOCKS && (buf = poolAlloc()) != 0) {
+            flowBlocks[flowHeld++] = buf;
+        }
+        flowHold = 2;
+        eventTimerStart(&flowTimer, FLOW_HOLD_US, 0);
+    }
+}
+
+static void printLink(const Uart *uart) {
+    const UartStats *s = &uart->stats;
+
+    printf("link uart%u           : rx %u bytes (%u blocks, %u frames, pool empty %u), "
+           "tx %u bytes in %u messages\n", uart->number, s->rxBytes, s->rxBlocks, s->rxFrames,
+           s->rxNoBuffer, s->txBytes, s->txMessages);
+    if (uart->flow) {
+        printf("link uart%u rts/cts   : rts deasserted %u times\n", uart->number, s->rtsStops);
+    }
+    if (s->rxOverruns | s->rxBreaks | s->rxParityErrors | s->rxFramingErrors) {
+        printf("link uart%u errors    : overrun %u (resyncs %u), break %u, parity %u, framing %u, "
+               "last 0x%X\n", uart->number, s->rxOverruns, s->rxResyncs, s->rxBreaks,
+               s->rxParityErrors, s->rxFramingErrors, s->rxLastError);
+    }
+}
+
+static void printTrace(const char *name, unsigned int channel, const TraceStats *s) {
+    unsigned int n;
+
+    printf("  ch %2u %-7s : %6u x, min %8u, mean %8u, max %8u cycles, log2 buckets",
+           channel, name, s->count, s->min, traceMean(s), s->max);
+    for (n = 0; n < TRACE_BUCKETS; n++) {
+        if (s->hist[n]) {
+            printf(" %u:%u", n, s->hist[n]);
+        }
+    }
+    printf("\n");
+}
+
+static void printEvents(void) {
+    static const char * const names[EVENT_PRIORITIES] = { "high", "normal", "low" };
+    EventStats e;
+    unsigned int p, n;
+
+    for (p = 0; p < EVENT_PRIORITIES; p++) {
+        eventGet(p, &e);
+        printf("event %-6s latency : %6u x, min %8u, mean %8u, max %8u cycles, log2 buckets",
+               names[p], e.latency.count, e.latency.min, traceMean(&e.latency), e.latency.max);
+        for (n = 0; n < TRACE_BUCKETS; n++) {
+            if (e.latency.hist[n]) {
+                printf(" %u:%u", n, e.latency.hist[n]);
+            }
+        }
+        printf("\nevent %-6s run     : %6u x, min %8u, mean %8u, max %8u cycles, %u dropped\n",
+               names[p], e.run.count, e.run.min, traceMean(&e.run), e.run.max, e.dropped);
+        hostExpect("event loop events dropped", e.dropped, 0, 0);
+    }
+}
+
+static void printChannels(const Uart *uart) {
+    TraceChannel t;
+
+    traceGet(uart->rxChannel, &t);
+    printTrace("rx", uart->rxChannel, &t.latency);
+    printTrace("rx isr", uart->rxChannel, &t.isr);
+    traceGet(uart->tx.channel, &t);
+    printTrace("tx", uart->tx.channel, &t.latency);
+    printTrace("tx isr", uart->tx.channel, &t.isr);
+}
+
+//========================================================================================================
+// Frames of the peer on an extra link: every frame sent arrives as sent, but the last one may still
+// be on the line. UART0 gets the burst too and loses nothing thanks to flow control, UART7 gets it
+// without and may lose up to OVERRUN_LOSS frames. It resyncs and logs an error once per pool hold,
+// however many characters the gap costs. UART5 counts the line errors of the peer.
+//========================================================================================================
+
+static void extraCheck(unsigned n) {
+    const Uart *uart = &extraLink[n];
+    const UartStats *s = &uart->stats;
+    unsigned sent = peerFrames, good = extraDecoder[n].frames - extraBad[n];
+    char what[64];
+
+    if (uart->number == FLOW_UART || uart->number == OVERRUN_UART) {
+        sent += FLOW_BURST - 1;
+    }
+    if (uart->number == OVERRUN_UART) {
+        snprintf(what, sizeof(what), "uart%u frames lost or not as sent", uart->number);
+        hostExpect(what, sent - good, 0, OVERRUN_LOSS);
+        snprintf(what, sizeof(what), "uart%u resyncs", uart->number);
+        hostExpect(what, s->rxResyncs, 1, FLOW_HOLDS);
+        snprintf(what, sizeof(what), "uart%u errors logged", uart->number);
+        hostExpect(what, s->rxOverruns + s->rxBreaks + s->rxParityErrors + s->rxFramingErrors, 1,
+                   FLOW_HOLDS);
+        return;
+    }
+    snprintf(what, sizeof(what), "uart%u slip frames", uart->number);
+    hostExpect(what, extraDecoder[n].frames, sent - 1, sent);
+    snprintf(what, sizeof(what), "uart%u slip frames dropped", uart->number);
+    hostExpect(what, extraDecoder[n].errors, 0, 0);
+    snprintf(what, sizeof(what), "uart%u slip frames not as sent", uart->number);
+    hostExpect(what, extraBad[n], 0, 0);
+    snprintf(what, sizeof(what), "uart%u overruns", uart->number);
+    hostExpect(what, s->rxOverruns + simStats.uart[uart->number].overruns, 0, 0);
+    if (uart->number == FLOW_UART) {
+        snprintf(what, sizeof(what), "uart%u rts deasserted", uart->number);
+        hostExpect(what, s->rtsStops, 1, ~0u);
+    }
+    if (uart->number == ERROR_UART) {
+        snprintf(what, sizeof(what), "uart%u breaks, parity and framing errors", uart->number);
+        hostExpect(what, s->rxBreaks + s->rxParityErrors + s->rxFramingErrors, 3, 3);
+    }
+}
+
+//========================================================================================================
+// The UART2 TX line has to start with the prompt, message and line end that main() of the firmware
+// queues as one scatter-gather message
+//========================================================================================================
+
+static void txLineCheck(const unsigned char *line, unsigned n) {
+    unsigned char expect[64];
+    unsigned len = 0;
+
+    memcpy(expect + len, prompt, sizeof(prompt) - 1);
+    len += sizeof(prompt) - 1;
+    memcpy(expect + len, message, sizeof(message) - 1);
+    len += sizeof(message) - 1;
+    memcpy(expect + len, lineEnd, sizeof(lineEnd) - 1);
+    len += sizeof(lineEnd) - 1;
+
+    hostExpect("uart2 tx line without prompt, message and line end",
+               n < len || memcmp(line, expect, len) != 0, 0, 0);
+}
+
+int main(int argc, char **argv) {
+    uint64_t cycles = argc > 1 ? strtoull(argv[1], 0, 0) : 7500000;
+    unsigned char line[1024], frame[64];
+    FrameDecoder echo;
+    IdleStats idle;
+    TraceChannel copyTrace;
+    unsigned n, greeting;
+
+    simReset();
+
+    appConfig();
+    crcCheck();
+    copyCheck();
+    peerEncode();
+    for (n = 0; n < EXTRA_LINKS; n++) {
+        frameDecoderInit(&extraDecoder[n], extraFrame[n], sizeof(extraFrame[n]), extraFrameReady,
+                         (void *)(uintptr_t)n);
+        if (uartOpen(&extraLink[n], extraNumber[n], EXTRA_BAUD, extraRx) != 0) {
+            fprintf(stderr, "udma_sim: cannot open uart%u\n", extraNumber[n]);
+            return 1;
+        }
+        if (extraNumber[n] == FLOW_UART) {
+            simUartCts(FLOW_UART, 0);
+            simUartPeerFlow(FLOW_UART, 1);
+            uartFlowControl(&extraLink[n]);
+        }
+        if (n == ASYNC_LINK && uartPace(&extraLink[n], PACE_TIMER, PACE_BPS, PACE_BURST) != 0) {
+            fprintf(stderr, "udma_sim: cannot pace uart%u\n", extraNumber[n]);
+            return 1;
+        }
+        txQueueReset(&extraLink[n].tx);
+        txQueueAdd(&extraLink[n].tx, message, sizeof(message) - 1);
+        txQueueSubmit(&extraLink[n].tx);
+    }
+    extraLink[STREAM_LINK].txHandler = streamTxDone;
+    simAdcInput(streamRamp);
+    if (adcStreamStart(&hostStream, STREAM_INPUT, STREAM_TIMER, STREAM_HZ, &streamEvent) != 0) {
+        fprintf(stderr, "udma_sim: cannot start the adc stream\n");
+        return 1;
+    }
+    hostExpect("timer of the event loop claimed again", udmaTimerAlloc(0) == 0, 0, 0);
+    hostExpect("timer of the adc stream claimed again", udmaTimerAlloc(STREAM_TIMER) == 0, 0, 0);
+    hostExpect("timer of the paced link claimed again", udmaTimerAlloc(PACE_TIMER) == 0, 0, 0);
+
+    eventPost(&asyncTask.event);
+    simAt(simStats.cycles, peerFrame);
+    while (simStats.cycles < cycles) {
+        flowStep();
+        eventRun();
+        logDrain();
+        eventWait();
+    }
+    rxConsume();
+    logDrain();
+    idleGet(&idle);
+
+    n = simUartCapture(2, line, sizeof(line));
+    txLineCheck(line, n);
+    for (greeting = 0; greeting + 1 < n && line[greeting] != '\n'; greeting++);
+    greeting++;
+    printf("uart2 tx line        : \"%.*s\" and %u bytes of echo\n", (int)greeting, line,
+           n - greeting);
+    frameDecoderInit(&echo, frame, sizeof(frame), echoFrameReady, 0);
+    cobsDecode(&echo, line + greeting, n - greeting);
+    printf("uart2 echo frames    : %u decoded, %u dropped, %u not as sent\n", echo.frames,
+           echo.errors, echoBad);
+    hostExpect("uart2 echo frames", echo.frames, peerFrames - 2, peerFrames);
+    hostExpect("uart2 echo frames dropped", echo.errors, 0, 0);
+    hostExpect("uart2 echo frames not as sent", echoBad, 0, 0);
+    printLink(&link2);
+    printChannels(&link2);
+    printf("uart2 rx fifo        : %u slices dropped, %u pool blocks free\n", rxFifo.dropped,
+           poolAvailable());
+    printf("uart2 cobs frames    : %u decoded, %u dropped, %u bad CRC\n", rxDecoder.frames,
+           rxDecoder.errors, rxCrcErrors);
+    hostExpect("uart2 cobs frames", rxDecoder.frames, peerFrames - 1, peerFrames);
+    hostExpect("uart2 cobs frames dropped", rxDecoder.errors, 0, 0);
+    hostExpect("uart2 cobs frames bad CRC", rxCrcErrors, 0, 0);
+    hostExpect("uart2 rx fifo slices dropped", rxFifo.dropped, 0, 0);
+    hostExpect("uart2 overruns", link2.stats.rxOverruns + simStats.uart[2].overruns, 0, 0);
+    for (n = 0; n < EXTRA_LINKS; n++) {
+        printLink(&extraLink[n]);
+        printChannels(&extraLink[n]);
+        printf("uart%u slip frames    : %u decoded, %u dropped, %u not as sent\n", extraNumber[n],
+               extraDecoder[n].frames, extraDecoder[n].errors, extraBad[n]);
+        extraCheck(n);
+    }
+    asyncCheck();
+    streamCheck();
+    traceGet(hostStream.channel, &copyTrace);
+    printTrace("adc", hostStream.channel, &copyTrace.latency);
+    printTrace("adc isr", hostStream.channel, &copyTrace.isr);
+    traceGet(dmaCopyChannel(), &copyTrace);
+    printTrace("sw", dmaCopyChannel(), &copyTrace.latency);
+    printTrace("sw isr", dmaCopyChannel(), &copyTrace.isr);
+    printEvents();
+    printf("firmware duty cycle  : awake %u ppm, %u wake-ups\n", idleAwakePpm(&idle),
+           idle.wakeups);
+    simReport(stdout);
+
+    hostExpect("vectors taken from flash", simStats.flashVectorFetches, 0, 0);
+    for (n = 0; n < SIM_NUM_UART; n++) {
+        hostExpect("uart reads of an empty RX FIFO", simStats.uart[n].rxEmptyReads, 0, 0);
+        hostExpect("uart writes into a full TX FIFO", simStats.uart[n].txFullWrites, 0, 0);
+    }
+    printf("host checks          : %u failed\n", hostFailures);
+    return hostFailures ? 1 : 0;
+}
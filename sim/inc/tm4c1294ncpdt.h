@@ -0,0 +1,213 @@
+//======================================================================================================
+// Host build replacement for the TivaWare device header inc/tm4c1294ncpdt.h
+//======================================================================================================
+// The firmware includes "inc/tm4c1294ncpdt.h" and pokes registers through the *_R macros. On the
+// board these expand to a volatile pointer at the peripheral address. In the host build the same
+// names expand to simReg(address), which hands back the register cell of the simulated peripheral
+// block (see sim.c) and advances the simulated clock by one bus access. The addresses are the real
+// TM4C1294NCPDT addresses, so the firmware sources compile unchanged.
+//
+// Only the registers that the firmware actually touches are listed here. Add new ones with the
+// address from the datasheet when a driver starts using them.
+//======================================================================================================
+
+#ifndef __TM4C1294NCPDT_H__
+#define __TM4C1294NCPDT_H__
+
+#include <stdint.h>
+#include "sim.h"
+
+//========================================================================================================
+// Register access by address (TivaWare hw_types.h), used by table driven drivers
+//========================================================================================================
+
+#define HWREG(x)                (*simReg(x))
+
+//========================================================================================================
+// Interrupt assignments (vector number minus 16)
+//========================================================================================================
+
+#define INT_UART0               5
+#define INT_UART1               6
+#define INT_ADC0SS3             17
+#define INT_TIMER0A             19
+#define INT_TIMER1A             21
+#define INT_TIMER2A             23
+#define INT_UART2               33
+#define INT_TIMER3A             35
+#define INT_UDMA                46
+#define INT_UDMAERR             47
+#define INT_UART3               56
+#define INT_UART4               57
+#define INT_UART5               58
+#define INT_UART6               59
+#define INT_UART7               60
+
+//========================================================================================================
+// UART2 registers
+//========================================================================================================
+
+#define UART2_DR_R              (*simReg(0x4000E000))
+#define UART2_RSR_R             (*simReg(0x4000E004))
+#define UART2_ECR_R             (*simReg(0x4000E004))
+#define UART2_FR_R              (*simReg(0x4000E018))
+#define UART2_IBRD_R            (*simReg(0x4000E024))
+#define UART2_FBRD_R            (*simReg(0x4000E028))
+#define UART2_LCRH_R            (*simReg(0x4000E02C))
+#define UART2_CTL_R             (*simReg(0x4000E030))
+#define UART2_IFLS_R            (*simReg(0x4000E034))
+#define UART2_IM_R              (*simReg(0x4000E038))
+#define UART2_RIS_R             (*simReg(0x4000E03C))
+#define UART2_MIS_R             (*simReg(0x4000E040))
+#define UART2_ICR_R             (*simReg(0x4000E044))
+#define UART2_DMACTL_R          (*simReg(0x4000E048))
+
+//========================================================================================================
+// Timer 0 registers
+//========================================================================================================
+
+#define TIMER0_CFG_R            (*simReg(0x40030000))
+#define TIMER0_TAMR_R           (*simReg(0x40030004))
+#define TIMER0_CTL_R            (*simReg(0x4003000C))
+#define TIMER0_IMR_R            (*simReg(0x40030018))
+#define TIMER0_RIS_R            (*simReg(0x4003001C))
+#define TIMER0_MIS_R            (*simReg(0x40030020))
+#define TIMER0_ICR_R            (*simReg(0x40030024))
+#define TIMER0_TAILR_R          (*simReg(0x40030028))
+#define TIMER0_TAV_R            (*simReg(0x40030050))
+
+//========================================================================================================
+// ADC0 registers
+//========================================================================================================
+
+#define ADC0_ACTSS_R            (*simReg(0x40038000))
+#define ADC0_RIS_R              (*simReg(0x40038004))
+#define ADC0_IM_R               (*simReg(0x40038008))
+#define ADC0_ISC_R              (*simReg(0x4003800C))
+#define ADC0_OSTAT_R            (*simReg(0x40038010))
+#define ADC0_EMUX_R             (*simReg(0x40038014))
+#define ADC0_PSSI_R             (*simReg(0x40038028))
+#define ADC0_SSMUX3_R           (*simReg(0x400380A0))
+#define ADC0_SSCTL3_R           (*simReg(0x400380A4))
+#define ADC0_SSFIFO3_R          (*simReg(0x400380A8))
+#define ADC0_PC_R               (*simReg(0x40038FC4))
+#define ADC0_CC_R               (*simReg(0x40038FC8))
+
+//========================================================================================================
+// GPIO port D (AHB aperture)
+//========================================================================================================
+
+#define GPIO_PORTD_AHB_DATA_R   (*simReg(0x4005B3FC))
+#define GPIO_PORTD_AHB_DIR_R    (*simReg(0x4005B400))
+#define GPIO_PORTD_AHB_AFSEL_R  (*simReg(0x4005B420))
+#define GPIO_PORTD_AHB_DEN_R    (*simReg(0x4005B51C))
+#define GPIO_PORTD_AHB_PCTL_R   (*simReg(0x4005B52C))
+
+//========================================================================================================
+// Micro Direct Memory Access registers
+//========================================================================================================
+
+#define UDMA_STAT_R             (*simReg(0x400FF000))
+#define UDMA_CFG_R              (*simReg(0x400FF004))
+#define UDMA_CTLBASE_R          (*simReg(0x400FF008))
+#define UDMA_ALTBASE_R          (*simReg(0x400FF00C))
+#define UDMA_WAITSTAT_R         (*simReg(0x400FF010))
+#define UDMA_SWREQ_R            (*simReg(0x400FF014))
+#define UDMA_USEBURSTSET_R      (*simReg(0x400FF018))
+#define UDMA_USEBURSTCLR_R      (*simReg(0x400FF01C))
+#define UDMA_REQMASKSET_R       (*simReg(0x400FF020))
+#define UDMA_REQMASKCLR_R       (*simReg(0x400FF024))
+#define UDMA_ENASET_R           (*simReg(0x400FF028))
+#define UDMA_ENACLR_R           (*simReg(0x400FF02C))
+#define UDMA_ALTSET_R           (*simReg(0x400FF030))
+#define UDMA_ALTCLR_R           (*simReg(0x400FF034))
+#define UDMA_PRIOSET_R          (*simReg(0x400FF038))
+#define UDMA_PRIOCLR_R          (*simReg(0x400FF03C))
+#define UDMA_ERRCLR_R           (*simReg(0x400FF04C))
+#define UDMA_CHASGN_R           (*simReg(0x400FF500))
+#define UDMA_CHIS_R             (*simReg(0x400FF504))
+#define UDMA_CHMAP0_R           (*simReg(0x400FF510))
+#define UDMA_CHMAP1_R           (*simReg(0x400FF514))
+#define UDMA_CHMAP2_R           (*simReg(0x400FF518))
+#define UDMA_CHMAP3_R           (*simReg(0x400FF51C))
+
+//========================================================================================================
+// CRC engine of the CCM module
+//========================================================================================================
+
+#define CCM0_CRCCTL_R           (*simReg(0x44030400))
+#define CCM0_CRCSEED_R          (*simReg(0x44030410))
+#define CCM0_CRCDIN_R           (*simReg(0x44030414))
+#define CCM0_CRCRSLTPP_R        (*simReg(0x44030418))
+
+//========================================================================================================
+// System control registers
+//========================================================================================================
+
+#define SYSCTL_RIS_R            (*simReg(0x400FE050))
+#define SYSCTL_MOSCCTL_R        (*simReg(0x400FE07C))
+#define SYSCTL_RSCLKCFG_R       (*simReg(0x400FE0B0))
+#define SYSCTL_MEMTIM0_R        (*simReg(0x400FE0C0))
+#define SYSCTL_PLLFREQ0_R       (*simReg(0x400FE160))
+#define SYSCTL_PLLFREQ1_R       (*simReg(0x400FE164))
+#define SYSCTL_PLLSTAT_R        (*simReg(0x400FE168))
+#define SYSCTL_RCGCTIMER_R      (*simReg(0x400FE604))
+#define SYSCTL_RCGCGPIO_R       (*simReg(0x400FE608))
+#define SYSCTL_RCGCDMA_R        (*simReg(0x400FE60C))
+#define SYSCTL_RCGCUART_R       (*simReg(0x400FE618))
+#define SYSCTL_RCGCADC_R        (*simReg(0x400FE638))
+#define SYSCTL_RCGCCCM_R        (*simReg(0x400FE674))
+#define SYSCTL_SCGCTIMER_R      (*simReg(0x400FE704))
+#define SYSCTL_SCGCGPIO_R       (*simReg(0x400FE708))
+#define SYSCTL_SCGCDMA_R        (*simReg(0x400FE70C))
+#define SYSCTL_SCGCUART_R       (*simReg(0x400FE718))
+#define SYSCTL_SCGCADC_R        (*simReg(0x400FE738))
+#define SYSCTL_DCGCGPIO_R       (*simReg(0x400FE808))
+#define SYSCTL_DCGCDMA_R        (*simReg(0x400FE80C))
+#define SYSCTL_DCGCUART_R       (*simReg(0x400FE818))
+#define SYSCTL_PRTIMER_R        (*simReg(0x400FEA04))
+#define SYSCTL_PRGPIO_R         (*simReg(0x400FEA08))
+#define SYSCTL_PRDMA_R          (*simReg(0x400FEA0C))
+#define SYSCTL_PRUART_R         (*simReg(0x400FEA18))
+#define SYSCTL_PRADC_R          (*simReg(0x400FEA38))
+#define SYSCTL_PRCCM_R          (*simReg(0x400FEA74))
+
+//========================================================================================================
+// NVIC registers
+//========================================================================================================
+
+#define NVIC_ST_CTRL_R          (*simReg(0xE000E010))
+#define NVIC_ST_RELOAD_R        (*simReg(0xE000E014))
+#define NVIC_ST_CURRENT_R       (*simReg(0xE000E018))
+#define NVIC_EN0_R              (*simReg(0xE000E100))
+#define NVIC_EN1_R              (*simReg(0xE000E104))
+#define NVIC_EN2_R              (*simReg(0xE000E108))
+#define NVIC_EN3_R              (*simReg(0xE000E10C))
+#define NVIC_DIS0_R             (*simReg(0xE000E180))
+#define NVIC_DIS1_R             (*simReg(0xE000E184))
+#define NVIC_DIS2_R             (*simReg(0xE000E188))
+#define NVIC_DIS3_R             (*simReg(0xE000E18C))
+#define NVIC_PEND0_R            (*simReg(0xE000E200))
+#define NVIC_PEND1_R            (*simReg(0xE000E204))
+#define NVIC_PEND2_R            (*simReg(0xE000E208))
+#define NVIC_PEND3_R            (*simReg(0xE000E20C))
+#define NVIC_UNPEND0_R          (*simReg(0xE000E280))
+#define NVIC_UNPEND1_R          (*simReg(0xE000E284))
+#define NVIC_UNPEND2_R          (*simReg(0xE000E288))
+#define NVIC_UNPEND3_R          (*simReg(0xE000E28C))
+#define NVIC_INT_CTRL_R         (*simReg(0xE000ED04))
+#define NVIC_VTABLE_R           (*simReg(0xE000ED08))
+#define NVIC_SYS_CTRL_R         (*simReg(0xE000ED10))
+
+//========================================================================================================
+// Wait for interrupt (CMSIS name): sleeps in the simulated clock. Data synchronization barrier:
+// the simulator applies every register write in order, a compiler barrier is enough. Interrupt
+// mask (CMSIS names): PRIMASK of the simulator.
+//========================================================================================================
+
+#define __WFI()                 simWfi()
+#define __disable_irq()         simPrimask(1)
+#define __enable_irq()          simPrimask(0)
+#define __DSB()                 __asm__ volatile ("" ::: "memory")
+
+#endif // __TM4C1294NCPDT_H__
@@ -0,0 +1,1682 @@
+//======================================================================================================
+// Host-side register level simulator of the TM4C1294 UART and uDMA blocks
+//======================================================================================================
+// See sim.h for what is modelled. Register cells are allocated per 4 KB peripheral page out of a
+// static pool, so every address handed to the firmware stays below 4 GB in the -no-pie host image.
+//
+// Access protocol:
+// simReg(addr) first applies the side effects of the previous access (sync), then advances the
+// clock by one cycle (which may run an interrupt handler), then loads the current read value of
+// addr into its cell (prepare) and returns the cell. Whatever the firmware stores into the cell is
+// picked up by the next sync. A store of exactly the value that was read cannot be told apart
+// from a read; this only matters for UARTDR (a byte equal to the RX FIFO head is taken as a read)
+// and is harmless for the W1S registers. W1C status registers that also read back their status
+// (DMACHIS, DMAERRCLR) are cleared by the access itself, i.e. they behave as clear-on-read.
+//======================================================================================================
+
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+
+//========================================================================================================
+// Register storage
+//========================================================================================================
+
+#define PERIPH_BASE             0x40000000u
+#define PERIPH_PAGES            0x8000u     // 0x40000000 - 0x47FFFFFF
+#define PPB_BASE                0xE0000000u
+#define PPB_PAGES               0x100u      // 0xE0000000 - 0xE00FFFFF
+#define POOL_PAGES              64
+
+static uint32_t pagePool[POOL_PAGES][1024];
+static uint32_t pageBase[POOL_PAGES];
+static unsigned pagesUsed;
+static uint32_t *pageMap[PERIPH_PAGES + PPB_PAGES];
+
+static int isDevice(uint32_t addr) {
+    return (addr - PERIPH_BASE) < (PERIPH_PAGES << 12) || (addr - PPB_BASE) < (PPB_PAGES << 12);
+}
+
+static uint32_t *cell(uint32_t addr) {
+    unsigned page;
+
+    if ((addr - PERIPH_BASE) < (PERIPH_PAGES << 12)) {
+        page = (addr - PERIPH_BASE) >> 12;
+    } else if ((addr - PPB_BASE) < (PPB_PAGES << 12)) {
+        page = PERIPH_PAGES + ((addr - PPB_BASE) >> 12);
+    } else {
+        fprintf(stderr, "sim: access to unmapped register 0x%08X\n", addr);
+        abort();
+    }
+    if (!pageMap[page]) {
+        if (pagesUsed == POOL_PAGES) {
+            fprintf(stderr, "sim: register page pool exhausted at 0x%08X\n", addr);
+            abort();
+        }
+        pageBase[pagesUsed] = addr & ~0xFFFu;
+        pageMap[page] = pagePool[pagesUsed++];
+    }
+    return &pageMap[page][(addr & 0xFFF) >> 2];
+}
+
+#define REG(addr)               (*cell(addr))
+
+//========================================================================================================
+// Translate an address found in a control structure: either a device address, a pointer into the
+// register pool (the firmware took &UARTx_DR_R) or plain host memory.
+//========================================================================================================
+
+static int toDevice(uint32_t addr, uint32_t *dev) {
+    uintptr_t p = (uintptr_t)addr;
+    uintptr_t lo = (uintptr_t)pagePool;
+    uintptr_t hi = lo + sizeof(pagePool);
+
+    if (isDevice(addr)) {
+        *dev = addr;
+        return 1;
+    }
+    if (p >= lo && p < hi && (p - lo) / sizeof(pagePool[0]) < pagesUsed) {
+        unsigned slot = (unsigned)((p - lo) / sizeof(pagePool[0]));
+        *dev = pageBase[slot] + (uint32_t)((p - lo) % sizeof(pagePool[0]));
+        return 1;
+    }
+    return 0;
+}
+
+//========================================================================================================
+// Register offsets and bits used by the model
+//========================================================================================================
+
+#define UART_DR                 0x000
+#define UART_RSR                0x004
+#define UART_FR                 0x018
+#define UART_IBRD               0x024
+#define UART_FBRD               0x028
+#define UART_LCRH               0x02C
+#define UART_CTL                0x030
+#define UART_IFLS               0x034
+#define UART_IM                 0x038
+#define UART_RIS                0x03C
+#define UART_MIS                0x040
+#define UART_ICR                0x044
+#define UART_DMACTL             0x048
+
+#define UART_CTL_UARTEN         0x0001
+#define UART_CTL_HSE            0x0020
+#define UART_CTL_EOT            0x0010
+#define UART_CTL_LBE            0x0080
+#define UART_CTL_TXE            0x0100
+#define UART_CTL_RXE            0x0200
+#define UART_CTL_RTS            0x0800
+#define UART_CTL_RTSEN          0x4000
+#define UART_CTL_CTSEN          0x8000
+
+#define UART_LCRH_STP2          0x08
+#define UART_LCRH_FEN           0x10
+#define UART_LCRH_PEN           0x02
+
+#define UART_FR_TXFE            0x80
+#define UART_FR_RXFF            0x40
+#define UART_FR_TXFF            0x20
+#define UART_FR_RXFE            0x10
+#define UART_FR_BUSY            0x08
+#define UART_FR_CTS             0x01
+
+#define UART_INT_RX             0x00010
+#define UART_INT_TX             0x00020
+#define UART_INT_RT             0x00040
+#define UART_INT_OE             0x00400
+#define UART_INT_FE_SHIFT       7           // FE, PE, BE, OE in RIS bits 7..10, RSR bits 0..3
+#define UART_RSR_OE             0x8
+#define UART_INT_DMARX          0x10000
+#define UART_INT_DMATX          0x20000
+
+#define UART_DMACTL_RXDMAE      0x01
+#define UART_DMACTL_TXDMAE      0x02
+
+#define UDMA_BASE               0x400FF000u
+#define UDMA_STAT               0x000
+#define UDMA_CFG                0x004
+#define UDMA_CTLBASE            0x008
+#define UDMA_ALTBASE            0x00C
+#define UDMA_WAITSTAT           0x010
+#define UDMA_SWREQ              0x014
+#define UDMA_USEBURSTSET        0x018
+#define UDMA_USEBURSTCLR        0x01C
+#define UDMA_REQMASKSET         0x020
+#define UDMA_REQMASKCLR         0x024
+#define UDMA_ENASET             0x028
+#define UDMA_ENACLR             0x02C
+#define UDMA_ALTSET             0x030
+#define UDMA_ALTCLR             0x034
+#define UDMA_PRIOSET            0x038
+#define UDMA_PRIOCLR            0x03C
+#define UDMA_ERRCLR             0x04C
+#define UDMA_CHIS               0x504
+#define UDMA_CHMAP0             0x510
+
+#define SYSCTL_BASE             0x400FE000u
+#define SYSCTL_RCGC_FIRST       0x600
+#define SYSCTL_RCGC_LAST        0x67C
+#define SYSCTL_PR_OFFSET        0x400       // PRx lives 0x400 above RCGCx
+#define SYSCTL_RIS              0x050
+#define SYSCTL_MOSCCTL          0x07C
+#define SYSCTL_RSCLKCFG         0x0B0
+#define SYSCTL_MEMTIM0          0x0C0
+#define SYSCTL_PLLFREQ0         0x160
+#define SYSCTL_PLLFREQ1         0x164
+#define SYSCTL_PLLSTAT          0x168
+
+#define MOSCCTL_NOXTAL          0x04
+#define MOSCCTL_PWRDN           0x08
+#define RIS_MOSCPUPRIS          0x100
+#define SYSCTL_SCGCUART         0x718
+#define SYSCTL_SCGCTIMER        0x704
+#define SYSCTL_SCGCDMA          0x70C
+#define SYSCTL_SCGCADC          0x738
+#define RSCLKCFG_ACG            0x20000000u
+#define RSCLKCFG_MEMTIMU        0x80000000u
+#define RSCLKCFG_USEPLL         0x10000000u
+#define PLLFREQ0_PLLPWR         0x00800000u
+
+#define GPTM_BASE               0x40030000u // Timer 0, Timer n at GPTM_BASE + n * 0x1000
+#define GPTM_CFG                0x000
+#define GPTM_TAMR               0x004
+#define GPTM_CTL                0x00C
+#define GPTM_IMR                0x018
+#define GPTM_RIS                0x01C
+#define GPTM_MIS                0x020
+#define GPTM_ICR                0x024
+#define GPTM_TAILR              0x028
+#define GPTM_TAV                0x050
+#define GPTM_DMAEV              0x06C
+#define GPTM_ADCEV              0x070
+
+#define GPTM_TAMR_PERIODIC      0x2
+#define GPTM_CTL_TAEN           0x01
+#define GPTM_CTL_TAOTE          0x20
+#define GPTM_INT_TATO           0x01
+#define GPTM_INT_DMAA           0x20
+#define GPTM_DMAEV_TATO         0x01
+#define GPTM_ADCEV_TATO         0x01
+
+#define ADC0_BASE               0x40038000u
+#define ADC_ACTSS               0x000
+#define ADC_RIS                 0x004
+#define ADC_IM                  0x008
+#define ADC_ISC                 0x00C
+#define ADC_OSTAT               0x010
+#define ADC_EMUX                0x014
+#define ADC_PSSI                0x028
+#define ADC_SSMUX3              0x0A0
+#define ADC_SSCTL3              0x0A4
+#define ADC_SSFIFO3             0x0A8
+#define ADC_ACTSS_ASEN3         0x008
+#define ADC_ACTSS_ADEN3         0x800
+#define ADC_INT_SS3             0x008       // INR3 / MASK3
+#define ADC_INT_DMASS3          0x800       // DMAINR3 / DMAMASK3
+#define ADC_OSTAT_OV3           0x008
+#define ADC_EMUX_EM3(e)         (((e) >> 12) & 0xF)
+#define ADC_EM_TIMER            0x5
+#define ADC_SSCTL_IE0           0x4
+#define ADC_SS3_DMA_CH          17          // channel of sample sequencer 3, encoding 0
+#define ADC_SS3_IRQ             17
+
+#define NVIC_EN0                0xE000E100u
+#define NVIC_DIS0               0xE000E180u
+#define NVIC_PEND0              0xE000E200u
+#define NVIC_UNPEND0            0xE000E280u
+
+#define ST_CTRL                 0xE000E010u
+#define ST_RELOAD               0xE000E014u
+#define ST_CURRENT              0xE000E018u
+#define ST_CTRL_ENABLE          0x01
+#define ST_CTRL_INTEN           0x02
+#define ST_CTRL_COUNT           0x10000
+
+#define CCM_BASE                0x44030000u
+#define CCM_CRCCTL              0x400
+#define CCM_CRCSEED             0x410
+#define CCM_CRCDIN              0x414
+#define CCM_CRCRSLTPP           0x418
+#define CRCCTL_TYPE(c)          ((c) & 0xF)
+#define CRCCTL_IBR              0x80
+#define CRCCTL_OBR              0x100
+#define CRCCTL_RESINV           0x200
+#define CRCCTL_SIZE8            0x1000
+#define CRCCTL_SBHW             0x20
+#define CRCCTL_SHW              0x10
+
+#define NVIC_INT_CTRL           0xE000ED04u
+#define NVIC_VTABLE             0xE000ED08u
+#define INT_CTRL_PENDSTSET      0x04000000u
+#define INT_CTRL_PENDSTCLR      0x02000000u
+
+#define DEMCR                   0xE000EDFCu
+#define DEMCR_TRCENA            0x01000000u
+#define DWT_CTRL                0xE0001000u
+#define DWT_CYCCNT              0xE0001004u
+
+//========================================================================================================
+// Control word fields
+//========================================================================================================
+
+#define CTL_MODE(c)             ((c) & 0x7)
+#define CTL_XFERSIZE(c)         (((c) >> 4) & 0x3FF)
+#define CTL_ARBSIZE(c)          (((c) >> 14) & 0xF)
+#define CTL_SRCSIZE(c)          (((c) >> 24) & 0x3)
+#define CTL_SRCINC(c)           (((c) >> 26) & 0x3)
+#define CTL_DSTINC(c)           (((c) >> 30) & 0x3)
+
+#define MODE_STOP               0
+#define MODE_BASIC              1
+#define MODE_AUTO               2
+#define MODE_PINGPONG           3
+#define MODE_MEM_SG             4
+#define MODE_MEM_SG_ALT         5
+#define MODE_PER_SG             6
+#define MODE_PER_SG_ALT         7
+
+//========================================================================================================
+// Peripheral models
+//========================================================================================================
+
+typedef struct {
+    uint32_t base;
+    unsigned irq;
+    uint32_t ris;
+    uint8_t rxFifo[16];
+    unsigned rxHead, rxCount;
+    uint8_t txFifo[16];
+    unsigned txHead, txCount;
+    uint8_t txByte;             // byte in the transmit shift register
+    uint32_t txShift;           // cycles left for txByte
+    uint32_t rxShift;           // cycles left until the next peer byte is complete
+    uint32_t rxIdle;            // cycles since the last received byte
+    uint8_t lineIn[SIM_LINE_LEN];
+    unsigned lineInHead, lineInCount;
+    uint8_t lineOut[SIM_LINE_LEN];
+    unsigned lineOutHead, lineOutCount;
+    uint32_t drRead;            // value prepared for the pending DR access
+    uint32_t rsr;               // receive status: FE, PE, BE, OE (bits 0..3), cleared through ECR
+    uint32_t rsrRead;           // value prepared for the pending RSR access
+    int peerFlow;               // the peer waits while RTS is deasserted
+    int cts;                    // CTS input as driven by the peer, 1 = asserted
+} SimUart;
+
+static SimUart uarts[SIM_NUM_UART];
+
+static const uint32_t uartBase[SIM_NUM_UART] = {
+    0x4000C000, 0x4000D000, 0x4000E000, 0x4000F000,
+    0x40010000, 0x40011000, 0x40012000, 0x40013000
+};
+static const unsigned uartIrq[SIM_NUM_UART] = { 5, 6, 33, 56, 57, 58, 59, 60 };
+static const unsigned fifoLevel[8] = { 2, 4, 8, 12, 14, 8, 8, 8 };
+
+//========================================================================================================
+// uDMA channel to peripheral assignments (TM4C1294 datasheet, table 9-1), UART entries only
+//========================================================================================================
+
+typedef struct {
+    uint8_t ch;
+    uint8_t enc;
+    uint8_t uart;
+    uint8_t tx;
+} SimDmaMap;
+
+static const SimDmaMap uartDmaMap[] = {
+    {  8, 0, 0, 0 }, {  9, 0, 0, 1 }, { 22, 0, 1, 0 }, { 23, 0, 1, 1 },
+    {  0, 1, 2, 0 }, {  1, 1, 2, 1 }, {  8, 1, 1, 0 }, {  9, 1, 1, 1 },
+    { 12, 1, 2, 0 }, { 13, 1, 2, 1 }, {  6, 2, 5, 0 }, {  7, 2, 5, 1 },
+    { 10, 2, 6, 0 }, { 11, 2, 6, 1 }, { 16, 2, 3, 0 }, { 17, 2, 3, 1 },
+    { 18, 2, 4, 0 }, { 19, 2, 4, 1 }, { 20, 2, 7, 0 }, { 21, 2, 7, 1 },
+};
+
+typedef struct {
+    uint32_t ena, alt, prio, burst, reqmask;
+    uint32_t swreq;             // software requests not yet served to completion
+    uint32_t latched;           // auto / memory scatter-gather channels that run to completion
+    uint32_t chis;
+    uint32_t err;
+    uint32_t busy;              // cycles until the current arbitration unit is finished
+} SimDma;
+
+static SimDma dma;
+
+//========================================================================================================
+// General purpose timers: timer A of each block, 32 bit one-shot or periodic down count (CFG = 0).
+// With TATODMAEN in DMAEV a timeout is a burst request of the uDMA channel of timer A; the
+// completion of that channel raises DMAARIS. With TAOTE in CTL and TATOADCEN in ADCEV a timeout
+// triggers the ADC.
+//========================================================================================================
+
+typedef struct {
+    uint32_t base;
+    unsigned irq;
+    uint32_t ris;
+    uint32_t value;             // TAV
+    int running;                // TAEN
+    int dmaReq;                 // timeout not yet served by the uDMA
+} SimTimer;
+
+static SimTimer timers[SIM_NUM_TIMER];
+
+static const unsigned timerIrq[SIM_NUM_TIMER] = { 19, 21, 23, 35, 63, 65, 98, 100 };
+
+//========================================================================================================
+// uDMA channels of timer A (table 9-1): channel, encoding, timer
+//========================================================================================================
+
+static const uint8_t timerDmaMap[][3] = {
+    { 18, 0, 0 }, { 20, 0, 1 }, {  4, 1, 2 }, {  6, 1, 2 }, {  2, 1, 3 },
+};
+
+//========================================================================================================
+// ADC0, sample sequencer 3 (one step). A trigger starts a conversion of the input in SSMUX3 that
+// takes SIM_ADC_CONV_CYCLES; its result goes into the one deep FIFO, or is lost with OV3 in OSTAT
+// when the FIFO is still full. A trigger during a conversion is ignored.
+//========================================================================================================
+
+typedef struct {
+    uint32_t ris;
+    uint32_t ostat;
+    uint32_t fifo;              // result in the FIFO
+    int fifoFull;
+    uint32_t convert;           // cycles left of the running conversion, 0 if none
+    uint64_t count;             // conversions started, the sample number for adcInput
+} SimAdc;
+
+static SimAdc adc;
+static unsigned (*adcInput)(unsigned ain, uint64_t n);
+
+static uint32_t nvicEn[4];
+static uint32_t nvicPend[4];
+static void (*flashVectors[SIM_FLASH_VECTORS])(void);     // reset table, set by simSetVector()
+static int inIsr;
+static int pending;
+static uint32_t pendingAddr;
+static int ctlbaseWarned;
+static int clockWarned;
+static uint32_t memFws;                 // flash wait states in effect (MEMTIM0 applied by MEMTIMU)
+static int sleeping;
+static int primask;                     // interrupts masked (CPSID I)
+
+typedef struct {
+    uint32_t ctrl;
+    uint32_t current;
+    int count;                          // COUNTFLAG
+    uint32_t read;                      // CURRENT as last read, a different value is a write
+    int pending;                        // exception pending
+} SimSysTick;
+
+static SimSysTick sysTick;
+
+typedef struct {
+    uint32_t cyccnt;                    // CPU cycles, stopped while the CPU sleeps
+    uint32_t read;                      // CYCCNT as last read, a different value is a write
+} SimDwt;
+
+static SimDwt dwt;
+
+static uint32_t ccmCrc;                 // state of the CRC engine, before post-processing
+static int ccmWarned;
+
+static void (*eventFn)(void);
+static uint64_t eventAt;
+static int eventFired;
+
+SimStats simStats;
+
+//========================================================================================================
+// UART helpers
+//========================================================================================================
+
+static uint32_t uartReg(SimUart *u, uint32_t off) {
+    return REG(u->base + off);
+}
+
+static unsigned uartDepth(SimUart *u) {
+    return (uartReg(u, UART_LCRH) & UART_LCRH_FEN) ? 16 : 1;
+}
+
+static unsigned uartRxTrigger(SimUart *u) {
+    return (uartReg(u, UART_LCRH) & UART_LCRH_FEN) ? fifoLevel[(uartReg(u, UART_IFLS) >> 3) & 7] : 1;
+}
+
+static unsigned uartTxTrigger(SimUart *u) {
+    return (uartReg(u, UART_LCRH) & UART_LCRH_FEN) ? fifoLevel[uartReg(u, UART_IFLS) & 7] : 0;
+}
+
+static uint32_t uartBitCycles64(SimUart *u) {
+    uint32_t clkDiv = (uartReg(u, UART_CTL) & UART_CTL_HSE) ? 8 : 16;
+    return clkDiv * (uartReg(u, UART_IBRD) * 64 + (uartReg(u, UART_FBRD) & 0x3F));
+}
+
+static uint32_t uartFrameCycles(SimUart *u) {
+    uint32_t lcrh = uartReg(u, UART_LCRH);
+    uint32_t bits = 1 + 5 + ((lcrh >> 5) & 3) + ((lcrh & UART_LCRH_PEN) ? 1 : 0)
+                    + ((lcrh & UART_LCRH_STP2) ? 2 : 1);
+    return (bits * uartBitCycles64(u) + 32) / 64;
+}
+
+static void uartPushTx(SimUart *u, uint8_t byte, uint64_t *dropped) {
+    if (u->txCount == uartDepth(u)) {
+        (*dropped)++;
+        return;
+    }
+    u->txFifo[(u->txHead + u->txCount++) & 15] = byte;
+    if ((uartReg(u, UART_CTL) & UART_CTL_EOT) || u->txCount > uartTxTrigger(u)) {
+        u->ris &= ~UART_INT_TX;
+    }
+}
+
+static int uartPopRx(SimUart *u, uint8_t *byte) {
+    if (!u->rxCount) {
+        return 0;
+    }
+    *byte = u->rxFifo[u->rxHead];
+    u->rxHead = (u->rxHead + 1) & 15;
+    u->rxCount--;
+    if (u->rxCount < uartRxTrigger(u)) {
+        u->ris &= ~UART_INT_RX;
+    }
+    if (!u->rxCount) {
+        u->ris &= ~UART_INT_RT;
+    }
+    return 1;
+}
+
+static void uartReceive(SimUart *u, uint8_t byte) {
+    unsigned n = u - uarts;
+
+    u->rxIdle = 0;
+    if (u->rxCount == uartDepth(u)) {
+        simStats.uart[n].overruns++;
+        u->ris |= UART_INT_OE;
+        u->rsr |= UART_RSR_OE;
+        return;
+    }
+    u->rxFifo[(u->rxHead + u->rxCount++) & 15] = byte;
+    simStats.uart[n].rxBytes++;
+    if (u->rxCount >= uartRxTrigger(u)) {
+        u->ris |= UART_INT_RX;
+    }
+}
+
+//========================================================================================================
+// RTS output: with RTSEN asserted while the RX FIFO is below its trigger level, otherwise the RTS
+// bit of CTL
+//========================================================================================================
+
+static int uartRts(SimUart *u, uint32_t ctl) {
+    if (ctl & UART_CTL_RTSEN) {
+        return u->rxCount < uartRxTrigger(u);
+    }
+    return (ctl & UART_CTL_RTS) != 0;
+}
+
+static void uartStep(SimUart *u) {
+    uint32_t ctl = uartReg(u, UART_CTL);
+    uint32_t frame;
+
+    if (!(ctl & UART_CTL_UARTEN) || !uartReg(u, UART_IBRD)) {
+        return;
+    }
+    frame = uartFrameCycles(u);
+
+    //====================================================================================================
+    // Transmitter: shift register fed from the TX FIFO
+    //====================================================================================================
+
+    if (u->txShift && --u->txShift == 0) {
+        uint8_t byte = u->txByte;
+        simStats.uart[u - uarts].txBytes++;
+        if (ctl & UART_CTL_LBE) {
+            uartReceive(u, byte);
+        } else {
+            u->lineOut[(u->lineOutHead + u->lineOutCount) & (SIM_LINE_LEN - 1)] = byte;
+            if (u->lineOutCount < SIM_LINE_LEN) {
+                u->lineOutCount++;
+            } else {
+                u->lineOutHead = (u->lineOutHead + 1) & (SIM_LINE_LEN - 1);
+            }
+        }
+        if ((ctl & UART_CTL_EOT) && !u->txCount) {
+            u->ris |= UART_INT_TX;
+        }
+    }
+    if (!u->txShift && (ctl & UART_CTL_TXE) && u->txCount && (ctl & UART_CTL_CTSEN) && !u->cts) {
+        simStats.uart[u - uarts].ctsHeldCycles++;
+    } else if (!u->txShift && (ctl & UART_CTL_TXE) && u->txCount) {
+        unsigned before = u->txCount;
+        u->txByte = u->txFifo[u->txHead];
+        u->txHead = (u->txHead + 1) & 15;
+        u->txCount--;
+        u->txShift = frame;
+        if (!(ctl & UART_CTL_EOT) && before > uartTxTrigger(u) && u->txCount <= uartTxTrigger(u)) {
+            u->ris |= UART_INT_TX;
+        }
+    }
+
+    //====================================================================================================
+    // Receiver: the peer sends queued bytes back to back at the same baud rate. With flow control
+    // it does not start a byte while RTS is deasserted.
+    //====================================================================================================
+
+    if (u->lineInCount && (ctl & UART_CTL_RXE)) {
+        if (!u->rxShift && u->peerFlow && !uartRts(u, ctl)) {
+            simStats.uart[u - uarts].rtsHeldCycles++;
+        } else if (!u->rxShift) {
+            u->rxShift = frame;
+        }
+        if (u->rxShift && --u->rxShift == 0) {
+            uint8_t byte = u->lineIn[u->lineInHead];
+            u->lineInHead = (u->lineInHead + 1) & (SIM_LINE_LEN - 1);
+            u->lineInCount--;
+            uartReceive(u, byte);
+            return;
+        }
+    }
+    if (u->rxCount && ++u->rxIdle == (32 * uartBitCycles64(u)) / 64) {
+        u->ris |= UART_INT_RT;
+    }
+}
+
+static void uartDmaRequest(SimUart *u, int tx, int *single, int *burst) {
+    uint32_t dmactl = uartReg(u, UART_DMACTL);
+
+    if (tx) {
+        if (dmactl & UART_DMACTL_TXDMAE) {
+            *single = u->txCount < uartDepth(u);
+            *burst = u->txCount <= uartTxTrigger(u);
+        }
+    } else if (dmactl & UART_DMACTL_RXDMAE) {
+        *single = u->rxCount > 0;
+        *burst = u->rxCount >= uartRxTrigger(u);
+    }
+}
+
+static SimUart *uartAt(uint32_t addr) {
+    unsigned n;
+
+    for (n = 0; n < SIM_NUM_UART; n++) {
+        if ((addr & ~0xFFFu) == uartBase[n]) {
+            return &uarts[n];
+        }
+    }
+    return 0;
+}
+
+//========================================================================================================
+// Timers: counting down from TAILR, the step at 0 is the timeout; a periodic timer reloads TAILR
+// there (a period of TAILR + 1 cycles), a one-shot timer stops and clears TAEN
+//========================================================================================================
+
+static void adcTrigger(void);
+
+static SimTimer *timerAt(uint32_t addr) {
+    uint32_t n = (addr - GPTM_BASE) >> 12;
+
+    return n < SIM_NUM_TIMER ? &timers[n] : 0;
+}
+
+static void timerStep(SimTimer *t) {
+    if (!t->running) {
+        return;
+    }
+    if (t->value) {
+        t->value--;
+        return;
+    }
+    t->ris |= GPTM_INT_TATO;
+    if (REG(t->base + GPTM_DMAEV) & GPTM_DMAEV_TATO) {
+        t->dmaReq = 1;
+    }
+    if ((REG(t->base + GPTM_CTL) & GPTM_CTL_TAOTE) && (REG(t->base + GPTM_ADCEV) & GPTM_ADCEV_TATO) &&
+        ADC_EMUX_EM3(REG(ADC0_BASE + ADC_EMUX)) == ADC_EM_TIMER) {
+        adcTrigger();
+    }
+    if ((REG(t->base + GPTM_TAMR) & 0x3) == GPTM_TAMR_PERIODIC) {
+        t->value = REG(t->base + GPTM_TAILR);
+    } else {
+        t->running = 0;
+        REG(t->base + GPTM_CTL) &= ~GPTM_CTL_TAEN;
+    }
+}
+
+//========================================================================================================
+// ADC0 sample sequencer 3: triggers while ASEN3 is set, the conversion, the FIFO
+//========================================================================================================
+
+static void adcTrigger(void) {
+    if (!(REG(ADC0_BASE + ADC_ACTSS) & ADC_ACTSS_ASEN3)) {
+        return;
+    }
+    if (adc.convert) {
+        simStats.adcTriggersLost++;
+        return;
+    }
+    adc.convert = SIM_ADC_CONV_CYCLES;
+}
+
+static void adcStep(void) {
+    uint32_t value;
+
+    if (!adc.convert || --adc.convert) {
+        return;
+    }
+    value = adcInput ? adcInput(REG(ADC0_BASE + ADC_SSMUX3) & 0xF, adc.count) & 0xFFF : 0;
+    adc.count++;
+    simStats.adcConversions++;
+    if (adc.fifoFull) {
+        adc.ostat |= ADC_OSTAT_OV3;
+        simStats.adcOverflows++;
+    } else {
+        adc.fifo = value;
+        adc.fifoFull = 1;
+    }
+    if (REG(ADC0_BASE + ADC_SSCTL3) & ADC_SSCTL_IE0) {
+        adc.ris |= ADC_INT_SS3;
+    }
+}
+
+static uint32_t adcPop(void) {
+    uint32_t value = adc.fifo;
+
+    adc.fifoFull = 0;
+    return value;
+}
+
+//========================================================================================================
+// CRC engine of the CCM module: 32 bit polynomials (TYPE 0x2 and 0x3). A write to CRCSEED loads the
+// state; each write to CRCDIN shifts in one item, 8 or 32 bits (SIZE), after the byte swaps of
+// ENDIAN and, with IBR, bit reversed over the whole item, most significant bit first. CRCRSLTPP
+// reads the state bit reversed (OBR) and inverted (RESINV) as configured.
+//========================================================================================================
+
+static uint32_t reverse32(uint32_t v) {
+    uint32_t r = 0;
+    unsigned i;
+
+    for (i = 0; i < 32; i++, v >>= 1) {
+        r = (r << 1) | (v & 1);
+    }
+    return r;
+}
+
+static void ccmFeed(uint32_t value) {
+    uint32_t ctl = REG(CCM_BASE + CCM_CRCCTL);
+    unsigned bits = (ctl & CRCCTL_SIZE8) ? 8 : 32;
+    uint32_t poly;
+    unsigned i;
+
+    switch (CRCCTL_TYPE(ctl)) {
+    case 0x2: poly = 0x04C11DB7; break;
+    case 0x3: poly = 0x1EDC6F41; break;
+    default:
+        if (!ccmWarned) {
+            fprintf(stderr, "sim: CRC type 0x%X is not modelled\n", CRCCTL_TYPE(ctl));
+            ccmWarned = 1;
+        }
+        return;
+    }
+    if (bits == 8) {
+        value &= 0xFF;
+    } else {
+        if (ctl & CRCCTL_SBHW) {
+            value = ((value & 0x00FF00FFu) << 8) | ((value >> 8) & 0x00FF00FFu);
+        }
+        if (ctl & CRCCTL_SHW) {
+            value = (value << 16) | (value >> 16);
+        }
+    }
+    if (ctl & CRCCTL_IBR) {
+        value = reverse32(value) >> (32 - bits);
+    }
+    for (i = bits; i-- > 0;) {
+        uint32_t in = ((value >> i) & 1) ^ (ccmCrc >> 31);
+        ccmCrc = (ccmCrc << 1) ^ (in ? poly : 0);
+    }
+}
+
+static uint32_t ccmResult(void) {
+    uint32_t ctl = REG(CCM_BASE + CCM_CRCCTL);
+    uint32_t r = ccmCrc;
+
+    if (ctl & CRCCTL_OBR) {
+        r = reverse32(r);
+    }
+    return (ctl & CRCCTL_RESINV) ? ~r : r;
+}
+
+//========================================================================================================
+// Bus access on behalf of the uDMA
+//========================================================================================================
+
+static uint32_t busRead(uint32_t addr, unsigned size) {
+    uint32_t dev;
+
+    if (toDevice(addr, &dev)) {
+        SimUart *u = uartAt(dev);
+        if (u && (dev & 0xFFF) == UART_DR) {
+            uint8_t byte = 0;
+            if (!uartPopRx(u, &byte)) {
+                simStats.uart[u - uarts].rxEmptyReads++;
+            }
+            return byte;
+        }
+        if ((dev & ~3u) == ADC0_BASE + ADC_SSFIFO3) {
+            return adcPop();
+        }
+        return REG(dev & ~3u);
+    }
+    switch (size) {
+    case 1:  return *(volatile uint8_t *)(uintptr_t)addr;
+    case 2:  return *(volatile uint16_t *)(uintptr_t)addr;
+    default: return *(volatile uint32_t *)(uintptr_t)addr;
+    }
+}
+
+static void busWrite(uint32_t addr, unsigned size, uint32_t value) {
+    uint32_t dev;
+
+    if (toDevice(addr, &dev)) {
+        SimUart *u = uartAt(dev);
+        if (u && (dev & 0xFFF) == UART_DR) {
+            uartPushTx(u, (uint8_t)value, &simStats.uart[u - uarts].txFullWrites);
+            return;
+        }
+        if (dev == ADC0_BASE + ADC_SSFIFO3) {
+            return;
+        }
+        if (dev == CCM_BASE + CCM_CRCDIN) {
+            ccmFeed(value);
+            return;
+        }
+        REG(dev & ~3u) = value;
+        return;
+    }
+    switch (size) {
+    case 1:  *(volatile uint8_t *)(uintptr_t)addr = (uint8_t)value; break;
+    case 2:  *(volatile uint16_t *)(uintptr_t)addr = (uint16_t)value; break;
+    default: *(volatile uint32_t *)(uintptr_t)addr = value; break;
+    }
+}
+
+//========================================================================================================
+// uDMA controller
+//========================================================================================================
+
+static unsigned dmaEncoding(unsigned ch) {
+    return (REG(UDMA_BASE + UDMA_CHMAP0 + (ch / 8) * 4) >> ((ch % 8) * 4)) & 0xF;
+}
+
+static const SimDmaMap *dmaUartMap(unsigned ch) {
+    unsigned enc = dmaEncoding(ch);
+    unsigned i;
+
+    for (i = 0; i < sizeof(uartDmaMap) / sizeof(uartDmaMap[0]); i++) {
+        if (uartDmaMap[i].ch == ch && uartDmaMap[i].enc == enc) {
+            return &uartDmaMap[i];
+        }
+    }
+    return 0;
+}
+
+static SimTimer *dmaTimer(unsigned ch) {
+    unsigned enc = dmaEncoding(ch);
+    unsigned i;
+
+    for (i = 0; i < sizeof(timerDmaMap) / sizeof(timerDmaMap[0]); i++) {
+        if (timerDmaMap[i][0] == ch && timerDmaMap[i][1] == enc) {
+            return &timers[timerDmaMap[i][2]];
+        }
+    }
+    return 0;
+}
+
+static int dmaAdc(unsigned ch) {
+    return ch == ADC_SS3_DMA_CH && dmaEncoding(ch) == 0;
+}
+
+// A timer request is a burst that is taken by the channel as soon as it is seen: dmaStep() serves
+// every burst request it finds. Sample sequencer 3 requests singles while its FIFO holds a result.
+static void dmaRequest(unsigned ch, int *single, int *burst) {
+    const SimDmaMap *m = dmaUartMap(ch);
+    SimTimer *t;
+
+    *single = 0;
+    *burst = 0;
+    if (m) {
+        uartDmaRequest(&uarts[m->uart], m->tx, single, burst);
+    } else if ((t = dmaTimer(ch)) != 0 && t->dmaReq) {
+        t->dmaReq = 0;
+        *burst = 1;
+    } else if (dmaAdc(ch)) {
+        *single = adc.fifoFull && (REG(ADC0_BASE + ADC_ACTSS) & ADC_ACTSS_ADEN3);
+    }
+}
+
+static void dmaDone(unsigned ch) {
+    const SimDmaMap *m = dmaUartMap(ch);
+    SimTimer *t;
+
+    if (m) {
+        uarts[m->uart].ris |= m->tx ? UART_INT_DMATX : UART_INT_DMARX;
+    } else if ((t = dmaTimer(ch)) != 0) {
+        t->ris |= GPTM_INT_DMAA;
+    } else if (dmaAdc(ch)) {
+        adc.ris |= ADC_INT_DMASS3;
+    } else {
+        dma.chis |= 1u << ch;
+    }
+}
+
+static void dmaFinish(unsigned ch) {
+    uint32_t bit = 1u << ch;
+
+    dma.ena &= ~bit;
+    dma.swreq &= ~bit;
+    dma.latched &= ~bit;
+}
+
+static uint32_t dmaStructure(unsigned ch) {
+    uint32_t base = REG(UDMA_BASE + UDMA_CTLBASE);
+    return base + ch * 16 + ((dma.alt >> ch) & 1) * 0x200;
+}
+
+static int dmaBadAddress(uint32_t addr) {
+    return addr < 0x00100000u;      // flash and the null page are not reachable on the host
+}
+
+static void dmaServe(unsigned ch, int burst) {
+    uint32_t bit = 1u << ch;
+    uint32_t desc = dmaStructure(ch);
+    uint32_t srcEnd = busRead(desc, 4);
+    uint32_t dstEnd = busRead(desc + 4, 4);
+    uint32_t ctl = busRead(desc + 8, 4);
+    unsigned mode = CTL_MODE(ctl);
+    unsigned n = CTL_XFERSIZE(ctl) + 1;
+    unsigned size = 1u << CTL_SRCSIZE(ctl);
+    uint32_t srcStep = CTL_SRCINC(ctl) == 3 ? 0 : 1u << CTL_SRCINC(ctl);
+    uint32_t dstStep = CTL_DSTINC(ctl) == 3 ? 0 : 1u << CTL_DSTINC(ctl);
+    unsigned count = 1;
+    unsigned i;
+
+    simStats.dmaArbitrations++;
+    dma.busy = SIM_DMA_ARB_CYCLES - 1;
+    simStats.dmaBusCycles++;
+
+    if (mode == MODE_STOP) {
+        simStats.dmaStopFaults++;
+        dmaFinish(ch);
+        return;
+    }
+    if (mode == MODE_AUTO || mode == MODE_MEM_SG || mode == MODE_MEM_SG_ALT) {
+        dma.latched |= bit;
+    }
+    if (burst || (dma.latched & bit) || mode == MODE_PER_SG) {
+        count = 1u << CTL_ARBSIZE(ctl);
+        if (count > n) {
+            count = n;
+        }
+    }
+    if (dmaBadAddress(srcEnd) || dmaBadAddress(dstEnd)) {
+        dma.err |= 1;
+        dmaFinish(ch);
+        return;
+    }
+    for (i = 0; i < count; i++, n--) {
+        uint32_t v = busRead(srcEnd - (n - 1) * srcStep, size);
+        // a scatter-gather primary always writes the 4 words of the alternate structure
+        unsigned back = (mode == MODE_MEM_SG || mode == MODE_PER_SG) ? (n - 1) & 3 : n - 1;
+        busWrite(dstEnd - back * dstStep, size, v);
+    }
+    simStats.dmaItems += count;
+    dma.busy += count * SIM_DMA_ITEM_CYCLES;
+
+    if (mode == MODE_MEM_SG || mode == MODE_PER_SG) {
+        // primary scatter-gather: one task was copied into the alternate structure
+        busWrite(desc + 8, 4, n ? (ctl & ~(0x3FFu << 4)) | ((n - 1) << 4) : ctl & ~0x3FF7u);
+        dma.alt |= bit;
+    } else if (n) {
+        busWrite(desc + 8, 4, (ctl & ~(0x3FFu << 4)) | ((n - 1) << 4));
+    } else {
+        busWrite(desc + 8, 4, ctl & ~0x3FF7u);
+        if (mode == MODE_PINGPONG) {
+            dma.alt ^= bit;
+            dmaDone(ch);
+        } else if (mode == MODE_MEM_SG_ALT || mode == MODE_PER_SG_ALT) {
+            dma.alt &= ~bit;
+        } else {
+            dmaFinish(ch);
+            dmaDone(ch);
+        }
+    }
+}
+
+static void dmaStep(void) {
+    uint32_t candidates;
+    int pass;
+
+    if (dma.busy) {
+        dma.busy--;
+        simStats.dmaBusCycles++;
+        return;
+    }
+    if (!(REG(UDMA_BASE + UDMA_CFG) & 1)) {
+        return;
+    }
+    candidates = dma.ena & ~dma.reqmask;
+    for (pass = 0; pass < 2 && candidates; pass++) {
+        uint32_t set = candidates & (pass ? ~dma.prio : dma.prio);
+        while (set) {
+            unsigned ch = __builtin_ctz(set);
+            uint32_t bit = 1u << ch;
+            int single, burst;
+            set &= ~bit;
+            dmaRequest(ch, &single, &burst);
+            if ((dma.swreq | dma.latched) & bit) {
+                dmaServe(ch, 1);
+                return;
+            }
+            if (burst || (single && !(dma.burst & bit))) {
+                dmaServe(ch, burst);
+                return;
+            }
+            if (CTL_MODE(busRead(dmaStructure(ch) + 8, 4)) == MODE_PER_SG) {
+                dmaServe(ch, 1);
+                return;
+            }
+        }
+    }
+}
+
+//========================================================================================================
+// Interrupts
+//========================================================================================================
+
+static int irqAsserted(unsigned irq) {
+    unsigned n;
+
+    for (n = 0; n < SIM_NUM_UART; n++) {
+        if (uarts[n].irq == irq) {
+            return (uarts[n].ris & uartReg(&uarts[n], UART_IM)) != 0;
+        }
+    }
+    for (n = 0; n < SIM_NUM_TIMER; n++) {
+        if (timers[n].irq == irq) {
+            return (timers[n].ris & REG(timers[n].base + GPTM_IMR)) != 0;
+        }
+    }
+    if (irq == ADC_SS3_IRQ) {
+        return (adc.ris & REG(ADC0_BASE + ADC_IM) & (ADC_INT_SS3 | ADC_INT_DMASS3)) != 0;
+    }
+    if (irq == 46) {
+        return dma.chis != 0;
+    }
+    if (irq == 47) {
+        return dma.err != 0;
+    }
+    return 0;
+}
+
+static void sync(void);
+static void charge(uint32_t cycles);
+
+//========================================================================================================
+// Next exception to take: SysTick before the IRQs (lower vector number), then the lowest enabled
+// IRQ that is pending or asserted. -1 if none.
+//========================================================================================================
+
+static int nextIrq(void) {
+    unsigned w;
+
+    if (sysTick.pending) {
+        return SIM_IRQ_SYSTICK;
+    }
+    for (w = 0; w < 4; w++) {
+        uint32_t set = nvicEn[w];
+        while (set) {
+            unsigned irq = w * 32 + __builtin_ctz(set);
+            set &= set - 1;
+            if ((nvicPend[w] >> (irq % 32) & 1) || irqAsserted(irq)) {
+                return irq;
+            }
+        }
+    }
+    return -1;
+}
+
+static void dispatch(void) {
+    void (**table)(void);
+    void (*handler)(void);
+    int irq;
+
+    if (inIsr || primask || (irq = nextIrq()) < 0) {
+        return;
+    }
+    if (irq == SIM_IRQ_SYSTICK) {
+        sysTick.pending = 0;
+    } else {
+        nvicPend[irq / 32] &= ~(1u << (irq % 32));
+    }
+    table = (void (**)(void))(uintptr_t)REG(NVIC_VTABLE);
+    handler = table[irq == SIM_IRQ_SYSTICK ? 15 : 16 + irq];
+    if (!handler) {
+        fprintf(stderr, "sim: no handler installed for IRQ %u\n", irq);
+        abort();
+    }
+    inIsr = 1;
+    simStats.irqCount[irq]++;
+    if (table == flashVectors) {
+        simStats.flashVectorFetches++;
+    }
+    charge(SIM_ISR_ENTRY_CYCLES + (table == flashVectors ? memFws : 0));
+    handler();
+    sync();
+    charge(SIM_ISR_EXIT_CYCLES);
+    inIsr = 0;
+}
+
+//========================================================================================================
+// Clock
+//========================================================================================================
+
+//========================================================================================================
+// SysTick counts down from RELOAD to 0, sets COUNTFLAG and raises its exception on the 1 -> 0 step
+// and reloads on the next clock.
+//========================================================================================================
+
+static void sysTickStep(void) {
+    if (!(sysTick.ctrl & ST_CTRL_ENABLE)) {
+        return;
+    }
+    if (sysTick.current == 0) {
+        sysTick.current = REG(ST_RELOAD) & 0xFFFFFF;
+    } else if (--sysTick.current == 0) {
+        sysTick.count = 1;
+        if (sysTick.ctrl & ST_CTRL_INTEN) {
+            sysTick.pending = 1;
+        }
+    }
+}
+
+//========================================================================================================
+// One system clock. While the CPU sleeps with auto clock gating, a peripheral only runs when its
+// bit in SCGC is set.
+//========================================================================================================
+
+static void stepPeripherals(void) {
+    int gated = sleeping && (REG(SYSCTL_BASE + SYSCTL_RSCLKCFG) & RSCLKCFG_ACG);
+    uint32_t uartClk = gated ? REG(SYSCTL_BASE + SYSCTL_SCGCUART) : 0xFF;
+    uint32_t timerClk = gated ? REG(SYSCTL_BASE + SYSCTL_SCGCTIMER) : 0xFF;
+    unsigned n;
+
+    simStats.cycles++;
+    for (n = 0; n < SIM_NUM_UART; n++) {
+        if (uartClk & (1u << n)) {
+            uartStep(&uarts[n]);
+        }
+    }
+    for (n = 0; n < SIM_NUM_TIMER; n++) {
+        if (timerClk & (1u << n)) {
+            timerStep(&timers[n]);
+        }
+    }
+    if (!gated || (REG(SYSCTL_BASE + SYSCTL_SCGCADC) & 1)) {
+        adcStep();
+    }
+    if (!gated || (REG(SYSCTL_BASE + SYSCTL_SCGCDMA) & 1)) {
+        dmaStep();
+    }
+    sysTickStep();
+    if (eventFn && simStats.cycles >= eventAt) {
+        void (*fn)(void) = eventFn;
+        eventFn = 0;
+        eventFired = 1;
+        fn();
+    }
+}
+
+static void charge(uint32_t cycles) {
+    int cyccnt = (REG(DEMCR) & DEMCR_TRCENA) && (REG(DWT_CTRL) & 1);
+
+    while (cycles--) {
+        stepPeripherals();
+        dwt.cyccnt += cyccnt;
+        simStats.cpuCycles++;
+        if (inIsr) {
+            simStats.isrCycles++;
+        }
+    }
+}
+
+//========================================================================================================
+// Apply the side effects of the pending register access
+//========================================================================================================
+
+static void syncUart(SimUart *u, uint32_t off, uint32_t *c) {
+    switch (off) {
+    case UART_DR:
+        if (*c != u->drRead) {
+            uartPushTx(u, (uint8_t)*c, &simStats.uart[u - uarts].txFullWrites);
+        } else {
+            uint8_t byte;
+            uartPopRx(u, &byte);
+        }
+        break;
+    case UART_ICR:
+        u->ris &= ~*c;
+        *c = 0;
+        break;
+    case UART_RSR:
+        if (*c != u->rsrRead) {
+            u->rsr = 0;                     // write to ECR
+        }
+        *c = u->rsr;
+        break;
+    }
+}
+
+//========================================================================================================
+// Setting TAEN starts the count at TAILR; a write to TAILR loads the counter right away (TAILD = 0)
+//========================================================================================================
+
+static void syncTimer(SimTimer *t, uint32_t off, uint32_t *c) {
+    switch (off) {
+    case GPTM_CTL:
+        if ((*c & GPTM_CTL_TAEN) && !t->running) {
+            t->value = REG(t->base + GPTM_TAILR);
+        }
+        t->running = (*c & GPTM_CTL_TAEN) != 0;
+        break;
+    case GPTM_TAILR:
+        if (t->running) {
+            t->value = *c;
+        }
+        break;
+    case GPTM_ICR:
+        t->ris &= ~*c;
+        *c = 0;
+        break;
+    }
+}
+
+//========================================================================================================
+// ISC and OSTAT are W1C and also read back their status, so the access itself clears them. PSSI
+// SS3 starts a conversion.
+//========================================================================================================
+
+static void syncAdc(uint32_t off, uint32_t *c) {
+    switch (off) {
+    case ADC_ISC:   adc.ris &= ~*c; *c = 0; break;
+    case ADC_OSTAT: adc.ostat &= ~*c; *c = 0; break;
+    case ADC_PSSI:
+        if (*c & 0x8) {
+            adcTrigger();
+        }
+        *c = 0;
+        break;
+    }
+}
+
+static void syncUdma(uint32_t off, uint32_t *c) {
+    switch (off) {
+    case UDMA_CTLBASE:
+        if ((*c & 0x3FF) && !ctlbaseWarned) {
+            fprintf(stderr, "sim: DMACTLBASE 0x%08X is not 1024-byte aligned, "
+                            "the controller uses 0x%08X\n", *c, *c & ~0x3FFu);
+            ctlbaseWarned = 1;
+        }
+        *c &= ~0x3FFu;
+        break;
+    case UDMA_SWREQ:     dma.swreq |= *c & dma.ena; *c = 0; break;
+    case UDMA_USEBURSTSET: dma.burst |= *c; break;
+    case UDMA_USEBURSTCLR: dma.burst &= ~*c; *c = 0; break;
+    case UDMA_REQMASKSET: dma.reqmask |= *c; break;
+    case UDMA_REQMASKCLR: dma.reqmask &= ~*c; *c = 0; break;
+    case UDMA_ENASET:    dma.ena |= *c; break;
+    case UDMA_ENACLR:    dma.ena &= ~*c; dma.latched &= ~*c; dma.swreq &= ~*c; *c = 0; break;
+    case UDMA_ALTSET:    dma.alt |= *c; break;
+    case UDMA_ALTCLR:    dma.alt &= ~*c; *c = 0; break;
+    case UDMA_PRIOSET:   dma.prio |= *c; break;
+    case UDMA_PRIOCLR:   dma.prio &= ~*c; *c = 0; break;
+    case UDMA_CHIS:      dma.chis &= ~*c; *c = 0; break;
+    case UDMA_ERRCLR:    dma.err &= ~(*c & 1); *c = 0; break;
+    }
+}
+
+//========================================================================================================
+// System clock: a write to RSCLKCFG switches the clock. Running from the PLL needs a powered and
+// locked PLL, and faster clocks need more flash wait states (MEMTIM0, applied with MEMTIMU).
+// Mistakes are reported once.
+//========================================================================================================
+
+static int mainOscRunning(void) {
+    return !(REG(SYSCTL_BASE + SYSCTL_MOSCCTL) & (MOSCCTL_PWRDN | MOSCCTL_NOXTAL));
+}
+
+static int pllLocked(void) {
+    return mainOscRunning() && (REG(SYSCTL_BASE + SYSCTL_PLLFREQ0) & PLLFREQ0_PLLPWR);
+}
+
+static void clockWarn(const char *what, uint32_t hz) {
+    if (!clockWarned) {
+        fprintf(stderr, "sim: %s at %u Hz\n", what, hz);
+        clockWarned = 1;
+    }
+}
+
+static void syncClock(uint32_t cfg) {
+    uint32_t f0 = REG(SYSCTL_BASE + SYSCTL_PLLFREQ0);
+    uint32_t f1 = REG(SYSCTL_BASE + SYSCTL_PLLFREQ1);
+    uint32_t src = (cfg >> 20) & 0xF;
+    uint32_t hz, need;
+    double vco;
+
+    if (cfg & RSCLKCFG_USEPLL) {
+        vco = (double)SIM_XTAL_HZ / ((((f1 >> 8) & 0x1F) + 1) * ((f1 & 0x1F) + 1)) *
+              ((f0 & 0x3FF) + ((f0 >> 10) & 0x3FF) / 1024.0);
+        hz = (uint32_t)(vco / ((cfg & 0x3FF) + 1));
+        if (!pllLocked()) {
+            clockWarn("switched to the PLL before it was locked", hz);
+        }
+    } else {
+        hz = (src == 3 ? SIM_XTAL_HZ : SIM_PIOSC_HZ) / (((cfg >> 10) & 0x3FF) + 1);
+        if (src == 3 && !mainOscRunning()) {
+            clockWarn("switched to the main oscillator before it was powered", hz);
+        }
+    }
+    if (cfg & RSCLKCFG_MEMTIMU) {
+        memFws = REG(SYSCTL_BASE + SYSCTL_MEMTIM0) & 0xF;   // MEMTIM0 is only applied with MEMTIMU
+    }
+    need = hz <= 16000000 ? 0 : hz <= 40000000 ? 1 : (hz - 1) / 20000000;
+    if (memFws < need) {
+        clockWarn("flash wait states too low for the system clock", hz);
+    }
+    simStats.sysclkHz = hz;
+}
+
+static void syncNvic(uint32_t addr, uint32_t *c) {
+    unsigned w = (addr & 0x7F) >> 2;
+
+    if (w >= 4) {
+        return;
+    }
+    switch (addr & ~0x7Fu) {
+    case NVIC_EN0:     nvicEn[w] |= *c; break;
+    case NVIC_DIS0:    nvicEn[w] &= ~*c; *c = 0; break;
+    case NVIC_PEND0:   nvicPend[w] |= *c; break;
+    case NVIC_UNPEND0: nvicPend[w] &= ~*c; *c = 0; break;
+    }
+}
+
+static void sync(void) {
+    uint32_t addr = pendingAddr;
+    uint32_t *c;
+    SimUart *u;
+    SimTimer *t;
+
+    if (!pending) {
+        return;
+    }
+    pending = 0;
+    c = cell(addr);
+    if ((u = uartAt(addr)) != 0) {
+        syncUart(u, addr & 0xFFF, c);
+    } else if ((t = timerAt(addr)) != 0) {
+        syncTimer(t, addr & 0xFFF, c);
+    } else if ((addr & ~0xFFFu) == UDMA_BASE) {
+        syncUdma(addr & 0xFFF, c);
+    } else if ((addr & ~0xFFFu) == ADC0_BASE) {
+        syncAdc(addr & 0xFFF, c);
+    } else if ((addr & ~0xFFFu) == SYSCTL_BASE) {
+        uint32_t off = addr & 0xFFF;
+        if (off >= SYSCTL_RCGC_FIRST && off <= SYSCTL_RCGC_LAST) {
+            REG(addr + SYSCTL_PR_OFFSET) = *c;
+        } else if (off == SYSCTL_RSCLKCFG) {
+            syncClock(*c);
+            *c &= ~(RSCLKCFG_MEMTIMU | 0x40000000u);    // MEMTIMU and NEWFREQ self clear
+        }
+    } else if (addr >= NVIC_EN0 && addr < NVIC_UNPEND0 + 0x80) {
+        syncNvic(addr, c);
+    } else if (addr == ST_CTRL) {
+        sysTick.ctrl = *c & 0x7;
+    } else if (addr == ST_CURRENT && *c != sysTick.read) {
+        sysTick.current = 0;
+        sysTick.count = 0;
+    } else if (addr == NVIC_INT_CTRL) {
+        if (*c & INT_CTRL_PENDSTCLR) {
+            sysTick.pending = 0;
+        }
+        *c = 0;
+    } else if (addr == DWT_CYCCNT && *c != dwt.read) {
+        dwt.cyccnt = *c;
+    } else if (addr == CCM_BASE + CCM_CRCSEED) {
+        ccmCrc = *c;
+    } else if (addr == CCM_BASE + CCM_CRCDIN) {
+        ccmFeed(*c);
+    }
+}
+
+//========================================================================================================
+// Load the read value of a register into its cell
+//========================================================================================================
+
+static void prepareUart(SimUart *u, uint32_t off, uint32_t *c) {
+    uint32_t fr = 0;
+
+    switch (off) {
+    case UART_DR:
+        *c = u->rxCount ? u->rxFifo[u->rxHead] : 0;
+        u->drRead = *c;
+        break;
+    case UART_FR:
+        fr |= u->txCount ? 0 : UART_FR_TXFE;
+        fr |= u->txCount == uartDepth(u) ? UART_FR_TXFF : 0;
+        fr |= u->rxCount ? 0 : UART_FR_RXFE;
+        fr |= u->rxCount == uartDepth(u) ? UART_FR_RXFF : 0;
+        fr |= (u->txCount || u->txShift) ? UART_FR_BUSY : 0;
+        fr |= u->cts ? UART_FR_CTS : 0;
+        *c = fr;
+        break;
+    case UART_RSR:
+        *c = u->rsr;
+        u->rsrRead = *c;
+        break;
+    case UART_RIS: *c = u->ris; break;
+    case UART_MIS: *c = u->ris & uartReg(u, UART_IM); break;
+    case UART_ICR: *c = 0; break;
+    }
+}
+
+static void prepareUdma(uint32_t off, uint32_t *c) {
+    switch (off) {
+    case UDMA_STAT:        *c = (REG(UDMA_BASE + UDMA_CFG) & 1) | (31u << 16); break;
+    case UDMA_ALTBASE:     *c = REG(UDMA_BASE + UDMA_CTLBASE) + 0x200; break;
+    case UDMA_WAITSTAT:    *c = 0; break;
+    case UDMA_USEBURSTSET: *c = dma.burst; break;
+    case UDMA_REQMASKSET:  *c = dma.reqmask; break;
+    case UDMA_ENASET:      *c = dma.ena; break;
+    case UDMA_ALTSET:      *c = dma.alt; break;
+    case UDMA_PRIOSET:     *c = dma.prio; break;
+    case UDMA_CHIS:        *c = dma.chis; break;
+    case UDMA_ERRCLR:      *c = dma.err; break;
+    case UDMA_SWREQ:
+    case UDMA_USEBURSTCLR:
+    case UDMA_REQMASKCLR:
+    case UDMA_ENACLR:
+    case UDMA_ALTCLR:
+    case UDMA_PRIOCLR:     *c = 0; break;
+    }
+}
+
+static void prepareTimer(SimTimer *t, uint32_t off, uint32_t *c) {
+    switch (off) {
+    case GPTM_RIS: *c = t->ris; break;
+    case GPTM_MIS: *c = t->ris & REG(t->base + GPTM_IMR); break;
+    case GPTM_ICR: *c = 0; break;
+    case GPTM_TAV: *c = t->value; break;
+    }
+}
+
+static void prepareAdc(uint32_t off, uint32_t *c) {
+    switch (off) {
+    case ADC_RIS:     *c = adc.ris; break;
+    case ADC_ISC:     *c = adc.ris & REG(ADC0_BASE + ADC_IM); break;
+    case ADC_OSTAT:   *c = adc.ostat; break;
+    case ADC_SSFIFO3: *c = adcPop(); break;
+    }
+}
+
+static void prepare(uint32_t addr, uint32_t *c) {
+    SimUart *u;
+    SimTimer *t;
+
+    if ((u = uartAt(addr)) != 0) {
+        prepareUart(u, addr & 0xFFF, c);
+    } else if ((t = timerAt(addr)) != 0) {
+        prepareTimer(t, addr & 0xFFF, c);
+    } else if ((addr & ~0xFFFu) == UDMA_BASE) {
+        prepareUdma(addr & 0xFFF, c);
+    } else if ((addr & ~0xFFFu) == ADC0_BASE) {
+        prepareAdc(addr & 0xFFF, c);
+    } else if (addr == SYSCTL_BASE + SYSCTL_RIS) {
+        *c = mainOscRunning() ? RIS_MOSCPUPRIS : 0;
+    } else if (addr == SYSCTL_BASE + SYSCTL_PLLSTAT) {
+        *c = pllLocked();
+    } else if (addr == ST_CTRL) {
+        *c = sysTick.ctrl | (sysTick.count ? ST_CTRL_COUNT : 0);
+        sysTick.count = 0;
+    } else if (addr == ST_CURRENT) {
+        *c = sysTick.current;
+        sysTick.read = *c;
+    } else if (addr == NVIC_INT_CTRL) {
+        *c = sysTick.pending ? INT_CTRL_PENDSTSET : 0;
+    } else if (addr == DWT_CYCCNT) {
+        *c = dwt.cyccnt;
+        dwt.read = *c;
+    } else if (addr == CCM_BASE + CCM_CRCRSLTPP) {
+        *c = ccmResult();
+    } else if ((addr & ~0x7Fu) == NVIC_EN0 && (addr & 0x7F) < 16) {
+        *c = nvicEn[(addr & 0x7F) >> 2];
+    } else if ((addr & ~0x7Fu) == NVIC_PEND0 && (addr & 0x7F) < 16) {
+        *c = nvicPend[(addr & 0x7F) >> 2];
+    } else if ((addr & ~0x7Fu) == NVIC_DIS0 || (addr & ~0x7Fu) == NVIC_UNPEND0) {
+        *c = 0;
+    }
+}
+
+//========================================================================================================
+// Public interface
+//========================================================================================================
+
+volatile uint32_t *simReg(uint32_t addr) {
+    uint32_t *c;
+
+    sync();
+    charge(1);
+    dispatch();
+    c = cell(addr);
+    prepare(addr, c);
+    pendingAddr = addr;
+    pending = 1;
+    return c;
+}
+
+void simReset(void) {
+    unsigned n;
+
+    memset(pagePool, 0, sizeof(pagePool));
+    memset(pageMap, 0, sizeof(pageMap));
+    pagesUsed = 0;
+    memset(uarts, 0, sizeof(uarts));
+    memset(&dma, 0, sizeof(dma));
+    memset(timers, 0, sizeof(timers));
+    memset(&adc, 0, sizeof(adc));
+    adcInput = 0;
+    memset(nvicEn, 0, sizeof(nvicEn));
+    memset(nvicPend, 0, sizeof(nvicPend));
+    memset(&simStats, 0, sizeof(simStats));
+    inIsr = 0;
+    pending = 0;
+    ctlbaseWarned = 0;
+    clockWarned = 0;
+    memFws = 0;
+    sleeping = 0;
+    primask = 0;
+    memset(&sysTick, 0, sizeof(sysTick));
+    memset(&dwt, 0, sizeof(dwt));
+    ccmCrc = 0;
+    ccmWarned = 0;
+    eventFn = 0;
+    eventFired = 0;
+    simStats.sysclkHz = SIM_PIOSC_HZ;
+    REG(SYSCTL_BASE + SYSCTL_MOSCCTL) = MOSCCTL_PWRDN | MOSCCTL_NOXTAL;
+    REG(SYSCTL_BASE + SYSCTL_MEMTIM0) = 0x00300030;
+    REG(NVIC_VTABLE) = (uint32_t)(uintptr_t)flashVectors;
+
+    for (n = 0; n < SIM_NUM_UART; n++) {
+        uarts[n].base = uartBase[n];
+        uarts[n].irq = uartIrq[n];
+        uarts[n].cts = 1;
+        REG(uartBase[n] + UART_CTL) = UART_CTL_TXE | UART_CTL_RXE;
+        REG(uartBase[n] + UART_IFLS) = 0x12;
+    }
+    for (n = 0; n < SIM_NUM_TIMER; n++) {
+        timers[n].base = GPTM_BASE + n * 0x1000;
+        timers[n].irq = timerIrq[n];
+    }
+}
+
+void simSetVector(unsigned irq, void (*handler)(void)) {
+    if (irq < SIM_NUM_IRQ) {
+        flashVectors[16 + irq] = handler;
+    } else if (irq == SIM_IRQ_SYSTICK) {
+        flashVectors[15] = handler;
+    }
+}
+
+void simRun(uint64_t cycles) {
+    uint64_t end = simStats.cycles + cycles;
+
+    sync();
+    while (simStats.cycles < end) {
+        stepPeripherals();
+        dispatch();
+    }
+}
+
+//========================================================================================================
+// WFI: nothing happens when an exception is already pending. Otherwise the CPU sleeps, the clock
+// runs on until an exception becomes pending or the host event fires, then the exception is taken.
+//========================================================================================================
+
+void simWfi(void) {
+    sync();
+    charge(1);
+    eventFired = 0;
+    sleeping = 1;
+    while (nextIrq() < 0 && !eventFired) {
+        stepPeripherals();
+        simStats.sleepCycles++;
+    }
+    sleeping = 0;
+    dispatch();
+}
+
+//========================================================================================================
+// CPSID I / CPSIE I: while masked, exceptions stay pending (and still end a WFI); unmasking takes a
+// pending one right away
+//========================================================================================================
+
+void simPrimask(int masked) {
+    sync();
+    charge(1);
+    primask = masked;
+    dispatch();
+}
+
+void simAt(uint64_t cycle, void (*event)(void)) {
+    eventAt = cycle;
+    eventFn = event;
+}
+
+void simAdcInput(unsigned (*input)(unsigned ain, uint64_t n)) {
+    adcInput = input;
+}
+
+void simUartFeed(unsigned uart, const void *data, unsigned len) {
+    SimUart *u = &uarts[uart % SIM_NUM_UART];
+    const uint8_t *p = data;
+
+    while (len-- && u->lineInCount < SIM_LINE_LEN) {
+        u->lineIn[(u->lineInHead + u->lineInCount++) & (SIM_LINE_LEN - 1)] = *p++;
+    }
+}
+
+void simUartLineError(unsigned uart, uint32_t status) {
+    SimUart *u = &uarts[uart % SIM_NUM_UART];
+
+    u->rsr |= status & 0xF;
+    u->ris |= (status & 0xF) << UART_INT_FE_SHIFT;
+}
+
+void simUartPeerFlow(unsigned uart, int on) {
+    uarts[uart % SIM_NUM_UART].peerFlow = on;
+}
+
+void simUartCts(unsigned uart, int asserted) {
+    uarts[uart % SIM_NUM_UART].cts = asserted;
+}
+
+unsigned simUartCapture(unsigned uart, void *out, unsigned max) {
+    SimUart *u = &uarts[uart % SIM_NUM_UART];
+    uint8_t *p = out;
+    unsigned n = 0;
+
+    while (n < max && u->lineOutCount) {
+        p[n++] = u->lineOut[u->lineOutHead];
+        u->lineOutHead = (u->lineOutHead + 1) & (SIM_LINE_LEN - 1);
+        u->lineOutCount--;
+    }
+    return n;
+}
+
+void simReport(FILE *out) {
+    const SimStats *s = &simStats;
+    uint64_t cycles = s->cycles ? s->cycles : 1;
+    uint64_t total = 0;
+    unsigned n;
+
+    fprintf(out, "simulated cycles     : %llu (%.3f ms at %u Hz)\n", (unsigned long long)s->cycles,
+            s->cycles * 1000.0 / s->sysclkHz, s->sysclkHz);
+    fprintf(out, "cpu busy cycles      : %llu (isr %llu)\n", (unsigned long long)s->cpuCycles,
+            (unsigned long long)s->isrCycles);
+    if (s->sleepCycles) {
+        fprintf(out, "cpu sleep cycles     : %llu (%.2f%%)\n", (unsigned long long)s->sleepCycles,
+                100.0 * s->sleepCycles / cycles);
+    }
+    fprintf(out, "udma items           : %llu in %llu arbitrations, bus busy %.2f%%\n",
+            (unsigned long long)s->dmaItems, (unsigned long long)s->dmaArbitrations,
+            100.0 * s->dmaBusCycles / cycles);
+    if (s->dmaStopFaults || dma.err) {
+        fprintf(out, "udma faults          : %llu requests on stopped structures, bus error %s\n",
+                (unsigned long long)s->dmaStopFaults, dma.err ? "set" : "clear");
+    }
+    if (s->adcConversions) {
+        fprintf(out, "adc0 ss3             : %llu conversions, %llu lost (FIFO full), %llu triggers "
+                "during a conversion\n", (unsigned long long)s->adcConversions,
+                (unsigned long long)s->adcOverflows, (unsigned long long)s->adcTriggersLost);
+    }
+    fprintf(out, "vector table         : 0x%08X (%s), %llu vectors taken from flash\n",
+            REG(NVIC_VTABLE), REG(NVIC_VTABLE) == (uint32_t)(uintptr_t)flashVectors ? "flash" : "sram",
+            (unsigned long long)s->flashVectorFetches);
+    for (n = 0; n < SIM_NUM_IRQ; n++) {
+        if (s->irqCount[n]) {
+            fprintf(out, "interrupts IRQ %-5u : %llu\n", n, (unsigned long long)s->irqCount[n]);
+        }
+    }
+    if (s->irqCount[SIM_IRQ_SYSTICK]) {
+        fprintf(out, "interrupts SysTick   : %llu\n",
+                (unsigned long long)s->irqCount[SIM_IRQ_SYSTICK]);
+    }
+    for (n = 0; n < SIM_NUM_UART; n++) {
+        const SimUartStats *us = &s->uart[n];
+        if (!(us->txBytes | us->rxBytes | us->overruns | us->rxEmptyReads | us->txFullWrites)) {
+            continue;
+        }
+        total += us->txBytes + us->rxBytes;
+        fprintf(out, "uart%u                : tx %llu rx %llu overrun %llu empty-reads %llu "
+                "full-writes %llu\n", n, (unsigned long long)us->txBytes,
+                (unsigned long long)us->rxBytes, (unsigned long long)us->overruns,
+                (unsigned long long)us->rxEmptyReads, (unsigned long long)us->txFullWrites);
+        if (us->rtsHeldCycles | us->ctsHeldCycles) {
+            fprintf(out, "uart%u flow control   : peer held by RTS %llu cycles, tx held by CTS %llu "
+                    "cycles\n", n, (unsigned long long)us->rtsHeldCycles,
+                    (unsigned long long)us->ctsHeldCycles);
+        }
+    }
+    fprintf(out, "bytes per cycle      : %.6f\n", (double)total / cycles);
+}
@@ -0,0 +1,135 @@
+//======================================================================================================
+// Host-side register level simulator of the TM4C1294 UART and uDMA blocks
+//======================================================================================================
+// The simulator keeps one 32 bit cell per register address. Firmware reaches the cells through
+// simReg() (the host inc/tm4c1294ncpdt.h maps every *_R macro onto it). Each register access costs
+// one simulated CPU cycle. Side effects of a write (W1C interrupt clear, W1S channel enable, a
+// byte pushed into the transmit FIFO, ...) are applied on the next access or when simRun() is
+// called, which is the same ordering the firmware sees on the real bus.
+//
+// Modelled:
+// - UART0..7: baud rate from IBRD/FBRD/HSE, frame length from LCRH, 16 deep TX/RX FIFOs, IFLS
+//   trigger levels, RIS/MIS/ICR/IM, DMACTL single/burst request lines and DMA done interrupts.
+//   The far end of every line is a peer that sends bytes queued with simUartFeed() at line rate
+//   and captures every transmitted byte. Flow control: CTSEN holds the transmitter while the CTS
+//   input set by simUartCts() is deasserted; after simUartPeerFlow() the peer holds its bytes
+//   while RTS (RTSEN: RX FIFO below its trigger level, else the RTS bit of CTL) is deasserted.
+//   Receive errors: an RX FIFO overrun sets OE in RIS and RSR; simUartLineError() raises framing,
+//   parity and break errors. A write to RSR (ECR) clears it.
+// - uDMA: CHMAP encodings, ENA/ALT/PRIO/USEBURST/REQMASK/SWREQ, walk of the primary and alternate
+//   control structures at CTLBASE for basic, auto, ping-pong and scatter-gather modes, arbitration
+//   every 2^ARBSIZE items and the completion interrupts.
+// - NVIC: EN/DIS/PEND/UNPEND and dispatch of the handlers in the vector table at VTOR (no nesting,
+//   lowest number first), including exception entry and exit cost. PRIMASK (simPrimask(), the
+//   __disable_irq()/__enable_irq() of the host header) holds the dispatch back. After simReset()
+//   VTOR points at the table of simSetVector(), which stands for the table in flash: taking a
+//   vector from it costs the flash wait states of MEMTIM0 on top of the entry. A table in firmware
+//   memory (vector.h) is taken as SRAM, without them. Its entries are host function pointers, not
+//   32 bit words.
+// - System control: clock from RSCLKCFG/PLLFREQ/MEMTIM0, SysTick (CTRL/RELOAD/CURRENT, its
+//   exception and PENDSTSET in NVIC_INT_CTRL), the DWT cycle counter (DEMCR TRCENA, DWT_CTRL
+//   CYCCNTENA, CYCCNT; it stops while the CPU sleeps), and sleep: simWfi() lets the clock run
+//   with the CPU idle until an interrupt is taken. With auto clock gating (ACG) only peripherals
+//   enabled in SCGC keep running meanwhile.
+// - Timers 0..7: timer A as a 32 bit one-shot or periodic down counter (CFG 0, TAMR, CTL TAEN,
+//   TAILR, TAV), its timeout in RIS/MIS/ICR with IMR and its interrupt. DMAEV TATODMAEN makes the
+//   timeout a burst request of the uDMA channel of timer A (GPTM0..3), whose completion raises
+//   DMAARIS; CTL TAOTE with ADCEV TATOADCEN makes it an ADC trigger.
+// - ADC0, sample sequencer 3: ACTSS ASEN3/ADEN3, EMUX EM3 (timer trigger), PSSI, SSMUX3, SSCTL3
+//   IE0, a conversion of SIM_ADC_CONV_CYCLES into the one deep SSFIFO3 (read by the CPU or the
+//   uDMA, a single request on channel 17 with ADEN3), OSTAT OV3 when a result finds it full,
+//   RIS/IM/ISC with INR3 and DMAINR3 and its interrupt. simAdcInput() gives the value of every
+//   conversion (12 bits, 0 without it).
+// - CCM CRC engine: CRCCTL/CRCSEED/CRCDIN/CRCRSLTPP for the 32 bit polynomials, written by the CPU
+//   or by the uDMA.
+// - simAt() schedules one host event (e.g. the peer starting a frame) at a given cycle. simWfi()
+//   also returns after the event, like a spurious wake-up. The event runs in the middle of the
+//   simulated clock and must not access registers; simUartFeed(), simUartCts(),
+//   simUartLineError() and simAt() are fine. The same holds for the input function of
+//   simAdcInput().
+//
+// The host build is linked with -no-pie so that firmware globals live below 4 GB and casts like
+// (unsigned int)controlTable keep working exactly as on the 32 bit target.
+//======================================================================================================
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+//========================================================================================================
+// Simulator limits and timing
+//========================================================================================================
+
+#define SIM_NUM_UART            8
+#define SIM_NUM_IRQ             128
+#define SIM_IRQ_SYSTICK         SIM_NUM_IRQ // simSetVector() number of the SysTick exception
+#define SIM_NUM_VECTORS         (SIM_NUM_IRQ + 1)
+#define SIM_FLASH_VECTORS       (SIM_NUM_IRQ + 16)  // exception numbers of the reset vector table
+#define SIM_NUM_DMA_CH          32
+#define SIM_NUM_TIMER           8
+#define SIM_LINE_LEN            65536       // peer side line buffer per UART (power of two)
+
+#define SIM_PIOSC_HZ            16000000u   // PIOSC, reset clock of the TM4C1294
+#define SIM_XTAL_HZ             25000000u   // MOSC crystal of the TM4C1294XL board
+#define SIM_ISR_ENTRY_CYCLES    12          // Cortex-M4 exception entry (stacking)
+#define SIM_ISR_EXIT_CYCLES     12          // exception return (unstacking)
+#define SIM_DMA_ARB_CYCLES      4           // control word fetch and write back per arbitration
+#define SIM_DMA_ITEM_CYCLES     2           // one read plus one write on the system bus
+#define SIM_ADC_CONV_CYCLES     120         // sampling and conversion, 1 us at 120 MHz
+
+//========================================================================================================
+// Statistics
+//========================================================================================================
+
+typedef struct {
+    uint64_t txBytes;           // bytes shifted out on the line
+    uint64_t rxBytes;           // bytes received into the RX FIFO
+    uint64_t overruns;          // bytes lost because the RX FIFO was full
+    uint64_t rxEmptyReads;      // DR reads with an empty RX FIFO
+    uint64_t txFullWrites;      // DR writes dropped because the TX FIFO was full
+    uint64_t rtsHeldCycles;     // cycles the peer waited for RTS with a byte to send
+    uint64_t ctsHeldCycles;     // cycles the transmitter waited for CTS with a byte to send
+} SimUartStats;
+
+typedef struct {
+    uint64_t cycles;            // simulated system clock cycles
+    uint32_t sysclkHz;          // current system clock, follows RSCLKCFG
+    uint64_t cpuCycles;         // cycles spent by the CPU on register accesses and ISR overhead
+    uint64_t sleepCycles;       // cycles the CPU spent in WFI
+    uint64_t isrCycles;         // part of cpuCycles spent in interrupt context
+    uint64_t dmaItems;          // items moved by the uDMA
+    uint64_t dmaArbitrations;   // control structure fetches
+    uint64_t dmaBusCycles;      // cycles the uDMA occupied the bus
+    uint64_t dmaStopFaults;     // requests served on a channel whose structure is in stop mode
+    uint64_t flashVectorFetches;    // exceptions whose vector came from the flash table
+    uint64_t adcConversions;    // conversions of ADC0 sample sequencer 3
+    uint64_t adcOverflows;      // results lost because its FIFO was full
+    uint64_t adcTriggersLost;   // triggers during a conversion
+    uint64_t irqCount[SIM_NUM_VECTORS];
+    SimUartStats uart[SIM_NUM_UART];
+} SimStats;
+
+extern SimStats simStats;
+
+//========================================================================================================
+// Simulator interface
+//========================================================================================================
+
+volatile uint32_t *simReg(uint32_t addr);
+void simReset(void);
+void simSetVector(unsigned irq, void (*handler)(void));
+void simRun(uint64_t cycles);
+void simWfi(void);
+void simPrimask(int masked);
+void simAt(uint64_t cycle, void (*event)(void));
+void simAdcInput(unsigned (*input)(unsigned ain, uint64_t n));
+void simUartFeed(unsigned uart, const void *data, unsigned len);
+void simUartLineError(unsigned uart, uint32_t status);
+void simUartPeerFlow(unsigned uart, int on);
+void simUartCts(unsigned uart, int asserted);
+unsigned simUartCapture(unsigned uart, void *out, unsigned max);
+void simReport(FILE *out);
+
+#endif // SIM_H